@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BoundedQueue.h"
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AsyncFileWriter
+ * @brief Writes blocks of data to files from a background thread.
+ *
+ * Callers hand over fully encoded blocks and carry on; the writer thread pushes them
+ * through a large stdio buffer. Consecutive blocks for the same path are appended to
+ * one open file, and a block for a new path closes the current file and starts the next.
+ * The queue between caller and writer is bounded, so encoding can never run more than a
+ * fixed number of blocks ahead of the disk. A path that cannot be opened or written is
+ * reported once and the rest of its blocks are dropped; close() then returns false.
+ */
+class AsyncFileWriter {
+public:
+    /**
+     * @brief Constructor for the AsyncFileWriter class. Starts the writer thread.
+     * @param queueCapacity The maximum number of blocks waiting to be written.
+     * @param bufferSize The size of the stdio buffer used for each open file, in bytes.
+     */
+    explicit AsyncFileWriter(std::size_t queueCapacity = 16, std::size_t bufferSize = 1 << 20);
+
+    /**
+     * @brief Destructor. Finishes writing every queued block.
+     */
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    /**
+     * @brief Queues a block to be written.
+     * @param path The file to write to. A new path truncates the file it names.
+     * @param data The bytes to write.
+     */
+    void write(const std::string& path, std::vector<char> data);
+
+    /**
+     * @brief Writes every queued block, closes the open file and stops the writer thread.
+     * @return true if every block was written successfully, false otherwise.
+     */
+    bool close();
+
+private:
+
+    struct Block {
+        std::string path;
+        std::vector<char> data;
+    };
+
+    std::size_t bufferSize; ///< stdio buffer size for each open file
+    BoundedQueue<Block> blocks; ///< Blocks waiting for the writer thread
+    bool failed; ///< Set by the writer thread if any open or write fails
+    bool closed; ///< Set once close() has run
+    std::thread thread; ///< The writer thread
+
+    /**
+     * @brief Body of the writer thread.
+     */
+    void run();
+};
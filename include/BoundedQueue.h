@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/**
+ * @class BoundedQueue
+ * @brief A blocking FIFO queue with a fixed capacity, used to connect pipeline stages.
+ *
+ * push() blocks while the queue is full and pop() blocks while it is empty, so a fast
+ * producer can never run more than `capacity` items ahead of its consumer. Once the
+ * producer calls close(), pop() drains the remaining items and then returns std::nullopt.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructor for the BoundedQueue class.
+     * @param capacity The maximum number of items held at once (at least 1).
+     */
+    explicit BoundedQueue(std::size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+    /**
+     * @brief Adds an item, waiting for space if the queue is full.
+     * @param item The item to add.
+     * @return true if the item was added, false if the queue has been closed.
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting for one if the queue is empty.
+     * @return The item, or std::nullopt once the queue is closed and drained.
+     */
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return item;
+    }
+
+    /**
+     * @brief Marks the end of the stream and wakes every waiting thread.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    std::size_t capacity; ///< Maximum number of queued items
+    bool closed; ///< Set once the producer has finished
+    std::deque<T> items; ///< The queued items
+    std::mutex mutex; ///< Guards every member above
+    std::condition_variable notEmpty; ///< Signalled when an item is added or the queue closes
+    std::condition_variable notFull; ///< Signalled when an item is removed or the queue closes
+};
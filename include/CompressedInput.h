@@ -0,0 +1,125 @@
+#pragma once
+
+#include "BoundedQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file CompressedInput.h
+ * @brief Transparent, streaming decompression of compressed input files.
+ */
+
+/**
+ * @brief The compression formats recognised on input.
+ */
+enum class CompressionFormat {
+    None,
+    Gzip,
+    Zstd
+};
+
+/**
+ * @brief Detects the compression format of a file from its leading magic bytes.
+ * @param filename The path to the file.
+ * @return The detected format, or None for plain or unreadable files.
+ */
+CompressionFormat detectCompression(const std::string& filename);
+
+/**
+ * @brief Checks whether support for a compression format was compiled in.
+ * @param format The format to check.
+ * @return true if files in this format can be read.
+ */
+bool isCompressionSupported(CompressionFormat format);
+
+/**
+ * @class DecompressingStreamBuf
+ * @brief A read-only stream buffer that decompresses a file on a background thread.
+ *
+ * The decompression thread fills fixed-size buffers and passes them to the reading side
+ * through a small ring of buffers that are handed back and forth, so decompression of the
+ * next block overlaps with parsing of the current one and memory use stays fixed.
+ * Nothing is written to disk. Corrupt or truncated data puts the reading stream into
+ * the bad state once the buffers filled before the damage was found have been read, so
+ * readers must read to the end to be sure the file was whole. If the reader stops early,
+ * destroying the stream buffer stops the decompression thread.
+ */
+class DecompressingStreamBuf : public std::streambuf {
+public:
+    /**
+     * @brief Constructor for the DecompressingStreamBuf class. Starts the decompression thread.
+     * @param filename The compressed file to read.
+     * @param format The compression format of the file.
+     * @param bufferSize The size of each decompressed buffer, in bytes.
+     * @param bufferCount The number of buffers in the ring.
+     */
+    DecompressingStreamBuf(const std::string& filename, CompressionFormat format,
+                           std::size_t bufferSize = 1 << 20, std::size_t bufferCount = 4);
+
+    /**
+     * @brief Destructor. Stops and joins the decompression thread.
+     */
+    ~DecompressingStreamBuf() override;
+
+    DecompressingStreamBuf(const DecompressingStreamBuf&) = delete;
+    DecompressingStreamBuf& operator=(const DecompressingStreamBuf&) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::string filename; ///< The compressed file
+    CompressionFormat format; ///< Its compression format
+    BoundedQueue<std::vector<char>> filledBuffers; ///< Decompressed data waiting to be parsed
+    BoundedQueue<std::vector<char>> emptyBuffers; ///< Parsed buffers handed back for reuse
+    std::vector<char> current; ///< The buffer currently being read
+    std::atomic<bool> failed{false}; ///< Set by the decompression thread if the file is unreadable, corrupt or truncated
+    std::thread thread; ///< The decompression thread
+
+    /**
+     * @brief Body of the decompression thread for gzip (and zlib) files.
+     */
+    void decompressGzip();
+
+    /**
+     * @brief Body of the decompression thread for zstd files.
+     */
+    void decompressZstd();
+
+    /**
+     * @brief Takes an empty buffer from the ring, sized to the buffer size.
+     * @param buffer Receives the buffer.
+     * @return false if the reading side has gone away.
+     */
+    bool takeEmptyBuffer(std::vector<char>& buffer);
+};
+
+/**
+ * @class DecompressingInputStream
+ * @brief An input stream reading through a DecompressingStreamBuf.
+ */
+class DecompressingInputStream : public std::istream {
+public:
+    /**
+     * @brief Constructor for the DecompressingInputStream class.
+     * @param filename The compressed file to read.
+     * @param format The compression format of the file.
+     */
+    DecompressingInputStream(const std::string& filename, CompressionFormat format);
+
+private:
+    DecompressingStreamBuf buffer; ///< Supplies the decompressed bytes
+};
+
+/**
+ * @brief Opens a file for reading, decompressing it on the fly if it is compressed.
+ * @param filename The path to the file.
+ * @return The stream, or nullptr if the file cannot be opened or its compression is not supported.
+ */
+std::unique_ptr<std::istream> openInputStream(const std::string& filename);
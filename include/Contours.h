@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Geometry.h"
+#include <vector>
+
+/**
+ * @file Contours.h
+ * @brief Functions for stitching slice lines into contours and measuring them.
+ */
+
+/**
+ * @brief Stitches directed slice lines into contours by joining matching endpoints.
+ *
+ * Lines are matched on exact endpoint equality, which holds for slices of a closed mesh
+ * because neighbouring triangles compute the crossing point of a shared edge identically.
+ * Chains that cannot be closed (holes in the mesh) are returned as open contours.
+ *
+ * @param lines The directed lines of one layer.
+ * @return The stitched contours.
+ */
+std::vector<Contour> stitchContours(const std::vector<Line>& lines);
+
+/**
+ * @brief Calculates the signed area enclosed by a closed contour using the shoelace formula.
+ * @param contour The contour to measure.
+ * @return The area, positive for counter-clockwise contours and negative for clockwise ones.
+ */
+double calculateSignedArea(const Contour& contour);
+
+/**
+ * @brief Calculates the length of a contour, including the closing edge if it is closed.
+ * @param contour The contour to measure.
+ * @return The contour length.
+ */
+double calculateContourLength(const Contour& contour);
+
+/**
+ * @brief Measures the cross-section described by a set of contours.
+ *
+ * Outer boundaries add to the area and holes subtract from it. Each outer boundary
+ * counts as one island. Open contours only contribute to the perimeter.
+ *
+ * @param contours The contours of one layer.
+ * @return The layer statistics.
+ */
+LayerStats calculateLayerStats(const std::vector<Contour>& contours);
+
+/**
+ * @brief Stitches a layer's crossing lines into contours and fills in its statistics.
+ * @param layer The layer to update.
+ */
+void buildLayerContours(Layer& layer);
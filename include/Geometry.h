@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
 #include <vector>
 
@@ -154,13 +155,41 @@ struct Line {
     Point2D end;
 };
 
+/**
+ * @struct Contour
+ * @brief Represents a chain of connected slice lines.
+ *
+ * Points are listed in order; a closed contour implicitly joins the last point back to the first.
+ * Outer boundaries run counter-clockwise and holes clockwise when seen from above.
+ */
+struct Contour {
+    std::vector<Point2D> points;
+    bool closed;
+};
+
+/**
+ * @struct LayerStats
+ * @brief Summary measurements of a slice layer's cross-section.
+ */
+struct LayerStats {
+    double area = 0.0; ///< Enclosed area of the closed contours, with holes subtracted
+    double perimeter = 0.0; ///< Total length of every contour
+    std::size_t islandCount = 0; ///< Number of separate outer boundaries
+};
+
 /**
  * @struct Layer 
  * @brief Represents a slice layer in 3D space.
  *
- * This structure defines a layer comprised of a series of Lines.
+ * This structure defines a layer comprised of a series of Lines where the model crosses the
+ * slice plane, the edges of any facets lying flat within the layer, the crossing lines
+ * stitched into contours, and any perimeters generated from those contours.
  */
 struct Layer {
-    std::vector<Line> lines;
+    std::vector<Line> lines; ///< Lines where the model crosses the slice plane
+    std::vector<Line> projectedLines; ///< Edges of facets lying within the layer, projected onto it
+    std::vector<Contour> contours; ///< The crossing lines stitched into contours
+    std::vector<std::vector<Contour>> perimeters; ///< Inset perimeter loops, outermost perimeter first
+    LayerStats stats; ///< Cross-section measurements of the contours
     double height;
 };
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "AsyncFileWriter.h"
+#include "Geometry.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @file LayerExport.h
+ * @brief Exporters that write sliced layers to disk as they are produced.
+ *
+ * Layers are encoded on the calling thread and written by an AsyncFileWriter, so
+ * exporters can be used directly as the layer sink of SlicePipeline or OutOfCoreSlicer.
+ */
+
+/**
+ * @class LayerExporter
+ * @brief Interface shared by the layer exporters.
+ */
+class LayerExporter {
+public:
+    virtual ~LayerExporter() = default;
+
+    /**
+     * @brief Encodes a layer and queues it for writing. Layers must be added lowest first.
+     * @param layer The layer to export.
+     */
+    virtual void addLayer(const Layer& layer) = 0;
+
+    /**
+     * @brief Writes everything still queued and closes the output.
+     * @return true if every layer was written successfully, false otherwise.
+     */
+    virtual bool finish() = 0;
+};
+
+/**
+ * @class SVGExporter
+ * @brief Writes one SVG file per layer, for inspecting slices by eye.
+ *
+ * Closed contours are filled (even-odd, so holes show), open contours are drawn in red,
+ * perimeters in blue and the edges of facets lying flat in the layer in grey. Y points up,
+ * as in the model.
+ */
+class SVGExporter : public LayerExporter {
+public:
+    /**
+     * @brief Constructor for the SVGExporter class.
+     * @param directory The directory to write layer_NNNNN.svg files into. It is created if needed.
+     */
+    explicit SVGExporter(const std::string& directory);
+
+    void addLayer(const Layer& layer) override;
+    bool finish() override;
+
+private:
+    std::string directory; ///< Where the SVG files are written
+    std::size_t layerIndex; ///< Index of the next layer, used in the file name
+    AsyncFileWriter writer; ///< Writes the files in the background
+};
+
+/**
+ * @class ContourExporter
+ * @brief Writes every layer's contours into one compact binary file.
+ *
+ * File layout (all integers little-endian):
+ *  - header: "FETACONT", u16 version, u16 flags (bit 0 = deflate), f64 resolution in mm
+ *  - one block per layer: u32 encoded size, u32 stored size, then the stored bytes,
+ *    which are the encoded bytes deflated when compression is on
+ *
+ * An encoded layer is its height (f64) followed by a varint contour count, then for each
+ * contour a varint of (point count << 1 | closed) and its points. Coordinates are
+ * quantised to multiples of the resolution; the first point is stored as zigzag varints
+ * and each further point as zigzag varint deltas from the previous one. Layers are
+ * compressed independently so they can be decoded one at a time.
+ */
+class ContourExporter : public LayerExporter {
+public:
+    /**
+     * @brief Constructor for the ContourExporter class. Queues the file header.
+     * @param path The file to write.
+     * @param resolution The size of one quantisation step, in mm.
+     * @param compress Whether to deflate each layer block. Ignored when built without zlib.
+     */
+    ContourExporter(const std::string& path, double resolution = 0.001, bool compress = true);
+
+    void addLayer(const Layer& layer) override;
+    bool finish() override;
+
+    /**
+     * @brief Checks whether deflate compression was compiled in.
+     * @return true if layer blocks can be compressed.
+     */
+    static bool compressionAvailable();
+
+private:
+    std::string path; ///< The output file
+    double resolution; ///< Quantisation step, in mm
+    bool compress; ///< Whether blocks are deflated
+    std::vector<char> encoded; ///< Scratch buffer reused for each layer
+    AsyncFileWriter writer; ///< Writes the blocks in the background
+};
+
+/**
+ * @brief Reads a file written by ContourExporter.
+ * The contours of each layer are restored and its statistics recalculated; lines are not stored.
+ * @param path The file to read.
+ * @param onLayer Called with each layer, lowest first.
+ * @return true if the whole file was read, false if it could not be opened or is malformed.
+ */
+bool readContourFile(const std::string& path, const std::function<void(Layer&&)>& onLayer);
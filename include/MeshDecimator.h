@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Geometry.h"
+#include "STLReader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class MeshDecimator
+ * @brief Produces a reduced-resolution copy of a mesh by clustering vertices on a voxel grid.
+ *
+ * Every vertex is snapped to the cell of a uniform grid it falls in, and all vertices in a
+ * cell are merged into one. The merged vertex is placed where it minimises the summed
+ * quadric error of the facets around it (falling back to the cell's mean vertex when that
+ * is ill-conditioned), which keeps flat faces flat and sharp edges sharp much better than
+ * plain averaging. Facets that collapse, and duplicate facets, are dropped.
+ *
+ * Every vertex moves by at most one cell diagonal, so the cell size bounds the error. All
+ * passes run in parallel; the merge is split into hash partitions that are processed
+ * independently. The result is a plain triangle list for STLReader::setTriangles, so the
+ * slicer and model statistics work on it unchanged.
+ */
+class MeshDecimator {
+public:
+    /**
+     * @brief Constructor for the MeshDecimator class.
+     * @param stlReader Reference to an STLReader object containing the full-resolution model.
+     */
+    explicit MeshDecimator(const STLReader& stlReader);
+
+    /**
+     * @brief Sets the number of threads used for decimation.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Decimates to roughly a target number of triangles, choosing the cell size by bisection.
+     * @param targetTriangleCount The desired number of triangles.
+     * @return The reduced triangles, or a copy of the model if it is already small enough.
+     */
+    std::vector<Triangle> decimateToCount(std::size_t targetTriangleCount) const;
+
+    /**
+     * @brief Decimates while keeping every vertex within a distance of its original position.
+     * @param maxError The largest distance a vertex may move, in mm.
+     * @return The reduced triangles.
+     */
+    std::vector<Triangle> decimateToError(double maxError) const;
+
+    /**
+     * @brief Decimates with a given grid cell size.
+     * @param cellSize The edge length of a grid cell, in mm.
+     * @return The reduced triangles.
+     */
+    std::vector<Triangle> decimateWithCellSize(double cellSize) const;
+
+private:
+    const STLReader& stlReader; ///< Reference to the STLReader object containing the model.
+    std::size_t threadCount; ///< Threads used for decimation, 0 for all hardware threads.
+
+    /**
+     * @brief Gets the key of the grid cell holding a point.
+     * @param point The point.
+     * @param cellSize The edge length of a grid cell.
+     * @return The cell indices packed into one integer, 21 bits per axis.
+     */
+    std::uint64_t cellKey(const Point3D& point, double cellSize) const;
+
+    /**
+     * @brief Gets the smallest cell size whose indices still fit in a cell key.
+     * @return The cell size.
+     */
+    double minimumCellSize() const;
+
+    /**
+     * @brief Counts the triangles that keep three distinct cells at a cell size.
+     * Duplicates are not removed, so this slightly overestimates the decimated count.
+     * @param cellSize The edge length of a grid cell.
+     * @return The number of surviving triangles.
+     */
+    std::size_t countSurvivingTriangles(double cellSize) const;
+};
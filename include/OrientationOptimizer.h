@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Geometry.h"
+#include "OverhangAnalyzer.h"
+#include "STLReader.h"
+#include <cstddef>
+
+/**
+ * @struct OrientationWeights
+ * @brief Relative importance of each term when scoring a build orientation. Lower scores win.
+ */
+struct OrientationWeights {
+    double layers = 1.0; ///< Weight of the layer count, relative to the tallest candidate
+    double overhang = 1.0; ///< Weight of the projected overhang area, relative to the surface area
+    double baseContact = 0.5; ///< Reward for base contact area, relative to the surface area
+};
+
+/**
+ * @struct OrientationResult
+ * @brief The chosen build orientation and how it scored.
+ */
+struct OrientationResult {
+    Vector3D buildDirection; ///< Direction in the original model that should point up (+Z)
+    Vector3D rotationAxis; ///< Axis of the rotation that brings buildDirection to +Z
+    double rotationAngle; ///< Angle of that rotation, in degrees
+    double score; ///< Weighted score of the orientation
+    std::size_t layerCount; ///< Number of layers needed in this orientation
+    OverhangReport report; ///< Overhang analysis of this orientation, without regions
+};
+
+/**
+ * @class OrientationOptimizer
+ * @brief Searches for the build orientation with the fewest layers, least overhang and best base contact.
+ *
+ * Candidate build directions are spread evenly over the sphere, with the six axis directions
+ * always included. Each candidate is scored by running the OverhangAnalyzer kernels against
+ * it, which only needs dot products of the stored normals and vertices with the direction,
+ * so the mesh is never rewritten. Candidates are evaluated in parallel.
+ */
+class OrientationOptimizer {
+public:
+    /**
+     * @brief Constructor for the OrientationOptimizer class.
+     * @param stlReader The model to orient. Its facets are copied into an OverhangAnalyzer.
+     */
+    explicit OrientationOptimizer(const STLReader& stlReader);
+
+    /**
+     * @brief Sets the number of threads used to evaluate candidates.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Sets the number of candidate directions spread over the sphere, besides the six axes.
+     * @param candidateCount The number of candidates.
+     */
+    void setCandidateCount(std::size_t candidateCount);
+
+    /**
+     * @brief Sets the weights used to score candidates.
+     * @param weights The weights.
+     */
+    void setWeights(const OrientationWeights& weights);
+
+    /**
+     * @brief Evaluates every candidate and returns the best one.
+     * Ties keep the earliest candidate, and the current orientation (+Z) is evaluated first.
+     * @param layerHeight The layer height used to count layers.
+     * @param criticalAngle The steepest printable overhang, in degrees from the vertical.
+     * @return The best orientation.
+     */
+    OrientationResult findBestOrientation(double layerHeight, double criticalAngle) const;
+
+    /**
+     * @brief Rotates a model so the chosen build direction points up.
+     * @param stlReader The model to rotate.
+     * @param result The orientation to apply.
+     */
+    static void applyOrientation(STLReader& stlReader, const OrientationResult& result);
+
+private:
+    OverhangAnalyzer analyzer; ///< Holds the facets in analysis-friendly form
+    double surfaceArea; ///< Surface area of the model, used to normalise area terms
+    std::size_t threadCount; ///< Threads used to evaluate candidates, 0 for all hardware threads
+    std::size_t candidateCount; ///< Candidates spread over the sphere
+    OrientationWeights weights; ///< Scoring weights
+};
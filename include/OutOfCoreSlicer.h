@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Geometry.h"
+#include "PerimeterGenerator.h"
+#include "STLReader.h"
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @class OutOfCoreSlicer
+ * @brief Slices models too large to hold in memory by splitting them into Z-bands on disk.
+ *
+ * One streaming pass over the STL file writes every triangle into a temporary bucket file
+ * for each Z-band whose layers it can cross, so no band depends on any other. Each band file is then loaded
+ * on its own, sliced with a regular Slicer and deleted. Peak memory is bounded by the
+ * largest band (times the number of bands sliced at once) rather than by the whole model.
+ */
+class OutOfCoreSlicer {
+public:
+    using LayerSink = std::function<void(Layer&&)>;
+
+    /**
+     * @brief Constructor for the OutOfCoreSlicer class.
+     * @param layerHeight The height of each slice layer.
+     * @param layersPerBand The number of slice layers covered by each on-disk band.
+     * @param tempDirectory Directory for the band files, or empty for the system temp directory.
+     */
+    OutOfCoreSlicer(double layerHeight, std::size_t layersPerBand, const std::string& tempDirectory = "");
+
+    /**
+     * @brief Sets how many bands are loaded and sliced at the same time.
+     * @param threadCount The number of bands in flight, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Generates the perimeters of every layer as its band is sliced, so the bands in flight generate them in parallel.
+     * @param perimeterGenerator The generator, which must outlive the slicer, or nullptr for none.
+     */
+    void setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator);
+
+    /**
+     * @brief Moves the model so its lowest point sits at the given Z-height while it is partitioned.
+     * This costs one extra Z-only pre-pass over the file.
+     * @param desiredZHeight The Z-height to move the model to.
+     */
+    void setZHeight(double desiredZHeight);
+
+    /**
+     * @brief Partitions the file into bands, then slices every band.
+     * @param filename The path to the STL file.
+     * @param sink Called with each finished layer, lowest first.
+     * @return true if the file was read and sliced, false otherwise.
+     */
+    bool run(const std::string& filename, const LayerSink& sink);
+
+    /**
+     * @brief Gets the number of triangles read by the last run.
+     * @return The triangle count.
+     */
+    std::size_t getTriangleCount() const;
+
+    /**
+     * @brief Gets the largest number of triangles held in memory for a single band by the last run.
+     * @return The triangle count of the largest band.
+     */
+    std::size_t getLargestBandSize() const;
+
+private:
+
+    struct Band {
+        std::string path;
+        std::vector<Triangle> pending;
+        std::size_t triangleCount;
+        std::unique_ptr<std::ofstream> file; ///< Open while the band is among the recently written ones
+    };
+
+    double layerHeight; ///< The height of each slice layer.
+    std::size_t layersPerBand; ///< Slice layers covered by each band.
+    std::string tempDirectory; ///< Where band files are written.
+    std::size_t threadCount; ///< Bands sliced concurrently, 0 for all hardware threads.
+    const PerimeterGenerator* perimeterGenerator; ///< Generates layer perimeters, if set.
+    std::optional<double> zHeight; ///< Z-height to move the model to, if set.
+    std::size_t triangleCount; ///< Triangles read by the last run.
+    std::size_t largestBandSize; ///< Largest band of the last run, in triangles.
+    std::deque<std::size_t> openBands; ///< Bands with an open file, oldest first.
+
+    /**
+     * @brief Appends the pending triangles of a band to its file.
+     * Band files stay open between flushes, up to a limit, after which the oldest is closed.
+     * @param bands The bands being written.
+     * @param index The band to flush.
+     * @return true if the write succeeded, false otherwise.
+     */
+    bool flushBand(std::vector<Band>& bands, std::size_t index);
+
+    /**
+     * @brief Closes every band file that is still open.
+     * @param bands The bands being written.
+     * @return true if every file was written successfully, false otherwise.
+     */
+    bool closeBands(std::vector<Band>& bands);
+
+    /**
+     * @brief Loads a band file back into memory.
+     * @param band The band to load.
+     * @param triangles Receives the triangles of the band.
+     * @return true if the read succeeded, false otherwise.
+     */
+    bool loadBand(const Band& band, std::vector<Triangle>& triangles) const;
+
+    /**
+     * @brief Slices the layers covered by one band.
+     * @param triangles The triangles of the band.
+     * @param firstLayer The index of the first layer in the band.
+     * @param layerCount The number of layers to slice.
+     * @return The sliced layers.
+     */
+    std::vector<Layer> sliceBand(std::vector<Triangle> triangles, std::size_t firstLayer, std::size_t layerCount) const;
+};
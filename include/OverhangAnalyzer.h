@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Geometry.h"
+#include "STLReader.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct OverhangRegion
+ * @brief A group of edge-connected overhanging facets that would share one support structure.
+ */
+struct OverhangRegion {
+    std::vector<std::size_t> triangles; ///< Indices of the facets in the region
+    double area = 0.0; ///< Total facet area
+    double projectedArea = 0.0; ///< Area of the facets projected onto the build plane
+    double supportVolume = 0.0; ///< Estimated support volume below the region
+    Point2D footprintMin; ///< Lower corner of the footprint on the build plane
+    Point2D footprintMax; ///< Upper corner of the footprint on the build plane
+};
+
+/**
+ * @struct OverhangReport
+ * @brief The result of an overhang analysis for one build direction.
+ */
+struct OverhangReport {
+    std::size_t overhangTriangleCount = 0; ///< Number of facets needing support
+    double overhangArea = 0.0; ///< Total area of the facets needing support
+    double projectedArea = 0.0; ///< Their area projected onto the build plane
+    double supportVolume = 0.0; ///< Estimated support volume, projected area times height above the plate
+    double baseContactArea = 0.0; ///< Area of the downward facets resting on the build plate
+    double height = 0.0; ///< Extent of the model along the build direction
+    std::vector<OverhangRegion> regions; ///< Connected overhang regions, largest first, if requested
+};
+
+/**
+ * @class OverhangAnalyzer
+ * @brief Classifies facets as overhangs against a build direction, without slicing.
+ *
+ * A facet is an overhang when it faces downwards more steeply than the critical angle,
+ * measured from the vertical (so 45 degrees flags anything flatter than a 45 degree slope).
+ * Facets resting on the lowest point of the model sit on the build plate and are counted
+ * as base contact instead.
+ *
+ * The facet normals, areas and vertex coordinates are copied once into flat arrays so
+ * the per-facet tests run as branch-free loops the compiler can vectorise, split across
+ * threads for large meshes. The stored normals are used as read, having been checked by
+ * STLReader when the file was loaded.
+ */
+class OverhangAnalyzer {
+public:
+    /**
+     * @brief Constructor for the OverhangAnalyzer class.
+     * @param stlReader The model to analyse. The facets are copied, so the reader may change afterwards.
+     */
+    explicit OverhangAnalyzer(const STLReader& stlReader);
+
+    /**
+     * @brief Sets the number of threads used by analyze.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Analyses the model for a build direction.
+     * @param buildDirection The direction the part grows in, in model coordinates. Need not be normalised.
+     * @param criticalAngle The steepest printable overhang, in degrees from the vertical.
+     * @param findRegions Whether to group overhanging facets into connected regions.
+     * @return The overhang report.
+     */
+    OverhangReport analyze(const Vector3D& buildDirection, double criticalAngle, bool findRegions = true) const;
+
+private:
+
+    /**
+     * Per-facet data in structure-of-arrays form, so each loop streams through whole arrays.
+     */
+    struct FacetArrays {
+        std::vector<double> normalX, normalY, normalZ;
+        std::vector<double> area;
+        std::vector<double> vertexX[3], vertexY[3], vertexZ[3];
+    };
+
+    FacetArrays facets; ///< The facets of the model
+    std::size_t facetCount; ///< Number of facets
+    std::size_t threadCount; ///< Threads used by analyze, 0 for all hardware threads
+
+    /**
+     * @brief Groups overhanging facets that share an edge into regions.
+     * @param overhangs Indices of the overhanging facets.
+     * @param buildDirection The normalised build direction.
+     * @param baseHeight The lowest vertex height along the build direction.
+     * @return The regions, largest projected area first.
+     */
+    std::vector<OverhangRegion> findOverhangRegions(const std::vector<std::size_t>& overhangs,
+                                                    const Vector3D& buildDirection, double baseHeight) const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @file Parallel.h
+ * @brief Minimal helpers for running independent work items on several threads.
+ */
+
+/**
+ * @brief Gets the number of worker threads to use for a requested thread count.
+ * @param requested The requested number of threads, or 0 to use every hardware thread.
+ * @return The thread count, at least 1.
+ */
+inline std::size_t resolveThreadCount(std::size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+/**
+ * @brief Calls fn(i) for every i in [0, count), spread over a number of threads.
+ *
+ * Indices are handed out one at a time from a shared counter, so uneven work items
+ * balance themselves. fn must be safe to call concurrently for different indices.
+ * With a single thread (or a single item) everything runs on the calling thread.
+ *
+ * @param count The number of work items.
+ * @param threadCount The number of threads to use, or 0 to use every hardware thread.
+ * @param fn The function to call with each index.
+ */
+template <typename Function>
+void parallelFor(std::size_t count, std::size_t threadCount, Function fn) {
+    threadCount = std::min(resolveThreadCount(threadCount), count);
+    if (threadCount <= 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (std::size_t t = 1; t < threadCount; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Geometry.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief How offset edges are joined around corners that point into the material.
+ */
+enum class JoinType {
+    Miter, ///< Extend the edges to a sharp corner, squared off beyond the miter limit
+    Round  ///< Follow an arc around the corner
+};
+
+/**
+ * @struct PerimeterSettings
+ * @brief Settings for generating perimeters.
+ */
+struct PerimeterSettings {
+    std::size_t count = 2; ///< Number of perimeters per layer
+    double lineWidth = 0.4; ///< Width of one extruded line, in mm
+    JoinType joinType = JoinType::Miter; ///< Join used at corners pointing into the material
+    double miterLimit = 2.0; ///< Longest miter, as a multiple of the offset distance
+    double arcTolerance = 0.005; ///< Largest distance a round join may stray from the true arc, in mm
+};
+
+/**
+ * @class PerimeterGenerator
+ * @brief Turns the closed contours of each layer into inset perimeter loops.
+ *
+ * Perimeter k runs along the centre of its line, offset (k + 0.5) line widths inside the
+ * layer outline, so each one is an independent offset of the original contours. Offsetting
+ * works on integer coordinates (0.1 µm units). Each contour edge is moved towards the
+ * material and the edges are joined at the corners. The raw offset loops overlap
+ * themselves and each other where features are thinner than the offset. They are cleaned
+ * up by splitting all edges where they cross and keeping only the pieces with material on
+ * exactly one side, judged by winding number, then stitching those back into loops. Area
+ * closer to the contours than the offset distance never counts as material, so a feature
+ * too thin for the offset vanishes instead of turning inside out.
+ * Outer loops come out counter-clockwise and holes clockwise, as for contours.
+ *
+ * Layers are independent, so generateLayers spreads them over threads.
+ */
+class PerimeterGenerator {
+public:
+    /**
+     * @brief Constructor for the PerimeterGenerator class.
+     * @param settings The perimeter settings.
+     */
+    explicit PerimeterGenerator(const PerimeterSettings& settings);
+
+    /**
+     * @brief Sets the number of threads used by generateLayers.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Fills in the perimeters of one layer from its closed contours.
+     * @param layer The layer to update.
+     */
+    void generateLayer(Layer& layer) const;
+
+    /**
+     * @brief Fills in the perimeters of every layer, in parallel.
+     * @param layers The layers to update.
+     */
+    void generateLayers(std::vector<Layer>& layers) const;
+
+    /**
+     * @brief Offsets the closed contours of a cross-section into the material.
+     * Open contours are ignored.
+     * @param contours The contours, outer boundaries counter-clockwise and holes clockwise.
+     * @param distance The offset distance, in mm.
+     * @return The cleaned-up offset loops.
+     */
+    std::vector<Contour> offsetContours(const std::vector<Contour>& contours, double distance) const;
+
+private:
+    PerimeterSettings settings; ///< The perimeter settings
+    std::size_t threadCount; ///< Threads used by generateLayers, 0 for all hardware threads
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Geometry.h"
+#include "PerimeterGenerator.h"
+#include "STLReader.h"
+#include "Slicer.h"
+#include <memory>
+#include <vector>
+
+/**
+ * @struct Placement
+ * @brief Positions one instance of a mesh on the build plate.
+ *
+ * The mesh is first rotated about the Z-axis through its own origin, then translated.
+ * Only Z-rotations are allowed so that every instance keeps the Z ordering of its mesh,
+ * which lets all instances share the mesh's sorted triangle index.
+ */
+struct Placement {
+    Vector3D translation; ///< Offset applied after the rotation
+    double rotationZ;     ///< Rotation about the Z-axis, in degrees
+};
+
+/**
+ * @class Plate
+ * @brief A build plate holding several instances of one or more meshes.
+ *
+ * Each mesh is stored once (the plate keeps a reference to its STLReader) and is
+ * prepared for slicing once. Instances only carry a Placement, so memory stays
+ * proportional to the unique geometry on the plate. Instances of the same mesh
+ * sitting at the same Z-offset are sliced once per layer and the resulting lines
+ * are transformed into place for each copy.
+ */
+class Plate {
+public:
+    /**
+     * @brief Constructor for the Plate class.
+     * @param layerHeight The height of each slice layer.
+     */
+    explicit Plate(double layerHeight);
+
+    /**
+     * @brief Sets the number of threads used to prepare meshes added after this call.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Generates the perimeters of every layer once the plate is sliced.
+     * @param perimeterGenerator The generator, which must outlive the plate, or nullptr for none.
+     */
+    void setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator);
+
+    /**
+     * @brief Adds a mesh to the plate. The STLReader must outlive the plate.
+     * @param stlReader The reader holding the mesh.
+     * @return The index of the mesh, used to place instances of it.
+     */
+    std::size_t addMesh(const STLReader& stlReader);
+
+    /**
+     * @brief Places an instance of a previously added mesh on the plate.
+     * @param meshIndex The index returned by addMesh.
+     * @param placement The position and Z-rotation of the instance.
+     * @return true if the instance was added, false if the mesh index is invalid.
+     */
+    bool addInstance(std::size_t meshIndex, const Placement& placement);
+
+    /**
+     * @brief Slices every instance on the plate, one sweep per layer.
+     * Layers start at Z = 0 and continue up to the top of the tallest instance. Perimeters, if
+     * enabled, are then generated for the finished layers in parallel.
+     */
+    void sliceModel();
+
+    /**
+     * @brief Gets the slice layers of the whole plate.
+     * @return The layers.
+     */
+    const std::vector<Layer>& getLayers() const;
+
+    /**
+     * @brief Gets the number of instances placed on the plate.
+     * @return The instance count.
+     */
+    std::size_t getInstanceCount() const;
+
+private:
+
+    struct Mesh {
+        const STLReader* stlReader;
+        std::unique_ptr<Slicer> slicer;
+    };
+
+    struct Instance {
+        std::size_t meshIndex;
+        Placement placement;
+        double cosRotation;
+        double sinRotation;
+    };
+
+    double layerHeight; ///< The height of each slice layer.
+    std::size_t threadCount; ///< Threads used to prepare added meshes, 0 for all hardware threads.
+    const PerimeterGenerator* perimeterGenerator; ///< Generates layer perimeters, if set.
+    std::vector<Mesh> meshes; ///< The unique meshes on the plate.
+    std::vector<Instance> instances; ///< The placed instances.
+    std::vector<Layer> layers; ///< Vector to store the resulting slice layers.
+
+    /**
+     * @brief Transforms a point from mesh coordinates into plate coordinates.
+     * @param point The point in mesh coordinates.
+     * @param instance The instance whose placement to apply.
+     * @return The point in plate coordinates.
+     */
+    Point2D placePoint(const Point2D& point, const Instance& instance) const;
+};
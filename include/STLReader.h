@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Geometry.h"
+#include <functional>
+#include <iosfwd>
 #include <vector>
 #include <string> 
 
@@ -38,12 +40,12 @@ private:
     bool parseVertex(const std::string& line, Point3D& vertex);
 
      /**
-     * @brief Reads a single triangle from the input file stream, comprised of three vertices. Calls validation on each triangle
-     * @param file The input file stream.
+     * @brief Reads a single triangle from the input stream, comprised of three vertices. Calls validation on each triangle
+     * @param file The input stream.
      * @param triangle The Triangle object to store the read triangle.
      * @return true if reading was successful, false otherwise.
      */
-    bool readTriangle(std::ifstream& file, Triangle& triangle);
+    bool readTriangle(std::istream& file, Triangle& triangle);
 
     /**
      * @brief Validates a triangle for correctness and updates total surface area.
@@ -80,6 +82,11 @@ private:
      */
     void translateVertex(Point3D& vertex, Vector3D translation);
 
+    /**
+     * @brief Re-calculates the bounding box from every triangle
+     */
+    void recalculateBoundingBox();
+
     /**
      * @brief Calculate the centroid the model
      * @return The centroid of the model
@@ -95,11 +102,31 @@ public:
 
     /**
      * @brief Reads an STL file and processes its contents.
+     * gzip and zstd compressed files are decompressed on the fly, when support for them is built in.
      * @param filename The path to the STL file.
      * @return true if the file was successfully read and processed, false otherwise.
      */
     bool readSTL(const std::string& filename);
 
+    /**
+     * @brief Reads an STL file and hands each valid triangle to a callback instead of storing it.
+     * Surface area and bounding box are still accumulated; the volume is not, as it needs every triangle.
+     * @param filename The path to the STL file.
+     * @param onTriangle Called once for every triangle, in file order.
+     * @return true if the file could be opened and read without error, false otherwise.
+     */
+    bool streamSTL(const std::string& filename, const std::function<void(const Triangle&)>& onTriangle);
+
+    /**
+     * @brief Cheap pre-pass over an STL file that only extracts the Z-coordinates of each facet.
+     * No triangles are built or validated, so this is much faster than a full read.
+     * @param filename The path to the STL file.
+     * @param onFacet Called with the lowest vertex Z of each facet, in file order.
+     * @param maxZ Receives the highest vertex Z in the file.
+     * @return true if the file could be opened and read without error and contained at least one facet, false otherwise.
+     */
+    bool scanFacetMinZ(const std::string& filename, const std::function<void(double)>& onFacet, double& maxZ) const;
+
     /**
      * @brief Re-calculates all the model statistics
      */
@@ -111,6 +138,13 @@ public:
      */
     const std::vector<Triangle>& getTriangles() const;
 
+    /**
+     * @brief Replaces the model with an existing set of triangles and re-calculates the model statistics.
+     * The triangles are assumed to be valid already.
+     * @param newTriangles The triangles making up the model.
+     */
+    void setTriangles(std::vector<Triangle> newTriangles);
+
     /**
      * @brief Gets the total surface area of all valid triangles.
      * @return The total surface area.
@@ -159,4 +193,11 @@ public:
      */
     void scaleModel(double scaleFactor);
 
+    /**
+     * @brief Rotates the model about its centroid. Normals are rotated with it.
+     * @param axis The axis to rotate about. Need not be normalised.
+     * @param angleDegrees The rotation angle in degrees, counter-clockwise looking down the axis.
+     */
+    void rotateModel(Vector3D axis, double angleDegrees);
+
 };
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Geometry.h"
+#include "PerimeterGenerator.h"
+#include "STLReader.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @class SlicePipeline
+ * @brief Runs load, prepare, slice and write as concurrent stages joined by bounded queues.
+ *
+ * A cheap pre-pass first records the lowest Z of every facet, so the pipeline knows how
+ * many triangles start in each layer. The stages then run on their own threads:
+ *  - load: parses the file and sends batches of triangles downstream,
+ *  - prepare: buckets triangles by the layer their minimum Z falls in, and releases a
+ *    bucket once every triangle counted for it (and for all lower buckets) has arrived,
+ *  - slice: sweeps upwards through the released buckets, keeping an active set of
+ *    triangles that span the current layer,
+ *  - perimeter: when perimeters are enabled, generates them for batches of sliced layers,
+ *    spreading each batch over threads,
+ *  - write: hands finished layers to the caller's sink, in order.
+ *
+ * Lower layers are therefore sliced and written while the top of the file is still being
+ * parsed, and wall-clock time approaches that of the slowest stage. The layers produced
+ * match those of Slicer::sliceModel, although lines within a layer may be ordered differently.
+ */
+class SlicePipeline {
+public:
+    using LayerSink = std::function<void(Layer&&)>;
+
+    /**
+     * @brief Constructor for the SlicePipeline class.
+     * @param layerHeight The height of each slice layer.
+     * @param queueCapacity The maximum number of items waiting between two stages.
+     */
+    explicit SlicePipeline(double layerHeight, std::size_t queueCapacity = 64);
+
+    /**
+     * @brief Moves the model so its lowest point sits at the given Z-height while it is loaded.
+     * @param desiredZHeight The Z-height to move the model to.
+     */
+    void setZHeight(double desiredZHeight);
+
+    /**
+     * @brief Sets the number of threads the perimeter stage spreads each batch of layers over.
+     * @param threadCount The number of threads, or 0 to use every hardware thread.
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * @brief Generates the perimeters of every layer before it is written.
+     * @param perimeterGenerator The generator, which must outlive the pipeline, or nullptr for none.
+     */
+    void setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator);
+
+    /**
+     * @brief Runs every stage on the given file and waits for them to finish.
+     * @param filename The path to the STL file.
+     * @param sink Called on the writer thread with each finished layer, lowest first.
+     * @return true if the file was read and sliced, false otherwise.
+     */
+    bool run(const std::string& filename, const LayerSink& sink);
+
+    /**
+     * @brief Gets the reader used by the load stage, for surface area and bounding box statistics.
+     * The bounding box is that of the model before any Z-height translation.
+     * @return A const reference to the reader.
+     */
+    const STLReader& getReader() const;
+
+    /**
+     * @brief Gets the number of triangles loaded by the last run.
+     * @return The triangle count.
+     */
+    std::size_t getTriangleCount() const;
+
+private:
+
+    struct TriangleZRange {
+        Triangle triangle;
+        double minZ;
+        double maxZ;
+    };
+
+    using TriangleBatch = std::vector<Triangle>;
+    using TriangleBucket = std::vector<TriangleZRange>;
+
+    double layerHeight; ///< The height of each slice layer.
+    std::size_t queueCapacity; ///< Capacity of each queue between stages.
+    std::optional<double> zHeight; ///< Z-height to move the model to, if set.
+    std::size_t threadCount; ///< Threads used by the perimeter stage, 0 for all hardware threads.
+    const PerimeterGenerator* perimeterGenerator; ///< Generates layer perimeters, if set.
+    STLReader reader; ///< Parses the file for the load stage.
+    std::size_t triangleCount; ///< Number of triangles loaded by the last run.
+
+    /**
+     * @brief Finds the layer bucket a triangle belongs to from its lowest Z.
+     * Rounds down, so a triangle is never released after the first layer that needs it.
+     * @param minZ The lowest Z of the triangle.
+     * @param numLayers The number of layers being sliced.
+     * @return The bucket index, or numLayers if the triangle starts above the last layer.
+     */
+    std::size_t bucketIndex(double minZ, std::size_t numLayers) const;
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Geometry.h"
+#include "PerimeterGenerator.h"
 #include "STLReader.h"
+#include <cstdint>
 #include <vector>
 
 /**
@@ -19,41 +21,85 @@ public:
      * @brief Constructor for the Slicer class.
      * @param stlReader Reference to an STLReader object containing the 3D model data.
      * @param layerHeight The height of each slice layer.
+     * @param threadCount Threads used to build the triangle index and by sliceModel, or 0 for every hardware thread.
      */
-    Slicer(const STLReader& stlReader, double layerHeight);
+    Slicer(const STLReader& stlReader, double layerHeight, std::size_t threadCount = 0);
 
     /**
      * @brief Performs the slicing operation on the 3D model.
+     * Layers are sliced, stitched into contours, measured and given perimeters in parallel.
      */
     void sliceModel();
 
+    /**
+     * @brief Generates the perimeters of every layer as it is sliced.
+     * @param perimeterGenerator The generator, which must outlive the slicer, or nullptr for none.
+     */
+    void setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator);
+
     /**
      * @brief Gets the slice layers.
      * @return The layers.
      */
     const std::vector<Layer>& getLayers() const;
 
-private:
+    /**
+     * @brief Slices the model with a single Z-plane.
+     * @param layerZ The Z-height of the slice plane, in model coordinates.
+     * @param triangleIndex Cursor into the Z-interval index. It is advanced past buckets whose
+     *        triangles all lie below layerZ, so it can be reused across layers of increasing Z.
+     * @param layer The layer to add the slice lines to.
+     */
+    void sliceLayer(double layerZ, std::size_t& triangleIndex, Layer& layer) const;
+
+    /**
+     * @brief Slices a single triangle with a Z-plane and adds the result to the layer.
+     * @param triangle The Triangle object to slice.
+     * @param layerZ The Z-height of the slice plane.
+     * @param thickness The thickness of a layer.
+     * @param layer The layer to add the projected triangle or intersection line to.
+     */
+    static void sliceTriangle(const Triangle& triangle, double layerZ, double thickness, Layer& layer);
 
-    struct TriangleZRange {
-        const Triangle* triangle;
-        double minZ;
-        double maxZ;
+private:
 
-        TriangleZRange(const Triangle* t);
+    /**
+     * @brief A triangle in the Z-interval index, with its Z-extent widened to the nearest floats.
+     */
+    struct ZIntervalEntry {
+        std::uint32_t triangle;
+        float minZ;
+        float maxZ;
     };
 
 
     const STLReader& stlReader; ///< Reference to the STLReader object containing the 3D model data.
     double layerHeight; ///< The height of each slice layer.
+    std::size_t threadCount = 0; ///< Threads used by sliceModel, 0 for all hardware threads.
+    const PerimeterGenerator* perimeterGenerator = nullptr; ///< Generates layer perimeters, if set.
     std::vector<Layer> layers; ///< Vector to store the resulting slice layers.
-    std::vector<TriangleZRange> triangleRanges; ///< Vector to store the sorted triangles
+    std::vector<ZIntervalEntry> zIndex; ///< Triangles grouped into buckets by their minimum Z
+    std::vector<std::size_t> bucketStart; ///< Offset of each bucket in zIndex, plus the end
+    std::vector<double> bucketReach; ///< Highest maximum Z of any triangle in this or an earlier bucket
+    double bucketBase = 0.0; ///< Z-height where the first bucket starts
+    double bucketHeight = 1.0; ///< Z-height covered by each bucket
 
     /**
-     * @brief Prepares the triangles by sorting them by Z-height
+     * @brief Builds the Z-interval index.
+     *
+     * Triangles are bucketed by the layer their minimum Z falls in with a parallel counting
+     * sort, which takes linear time. Within a bucket triangles keep their file order.
+     * Triangle IDs are 32-bit, so meshes with more triangles are rejected and leave the index empty.
      */
     void prepareTriangles();
 
+    /**
+     * @brief Gets the bucket a Z-height falls in, before clamping to the bucket range.
+     * @param z The Z-height.
+     * @return The bucket index, negative below the first bucket.
+     */
+    long long bucketIndex(double z) const;
+
     /**
      * @brief Checks to see if a triangle is fully contained by a slice layer.
      * @param triangle The Triangle object to check.
@@ -61,7 +107,7 @@ private:
      * @param thickness The thickness of a layer.
      * @return true if the triangle is fully captured by a layer.
      */
-    bool isTriangleInLayer(const Triangle& triangle, double layerZ, double thickness);
+    static bool isTriangleInLayer(const Triangle& triangle, double layerZ, double thickness);
 
     /**
      * @brief Projects a triangle onto the slice layer and adds it to the Layer
@@ -69,7 +115,7 @@ private:
      * @param layerZ The current layer Z-height.
      * @param layer The layer to add the triangle to.
      */
-    void addProjectedTriangleToLayer(const Triangle& triangle, double layerZ, Layer& layer);
+    static void addProjectedTriangleToLayer(const Triangle& triangle, double layerZ, Layer& layer);
 
     /**
      * @brief Checks to see if a triangle intersects a slice layer.
@@ -77,7 +123,7 @@ private:
      * @param layerZ The current layer Z-height.
      * @return true if the triangle is intersected by a layer.
      */
-    bool doesTriangleIntersectLayer(const Triangle& triangle, double layerZ);
+    static bool doesTriangleIntersectLayer(const Triangle& triangle, double layerZ);
 
     /**
      * @brief Adds the intersection line of the triangle along the slice plane to the Layer.
@@ -85,5 +131,5 @@ private:
      * @param layerZ The current layer Z-height.
      * @param layer The layer to add the triangle intersection points to.
      */
-    void addIntersectionLinesToLayer(const Triangle& triangle, double layerZ, Layer& layer);
+    static void addIntersectionLinesToLayer(const Triangle& triangle, double layerZ, Layer& layer);
 };
@@ -0,0 +1,68 @@
+#include "AsyncFileWriter.h"
+#include <cstdio>
+#include <iostream>
+#include <unordered_set>
+
+AsyncFileWriter::AsyncFileWriter(std::size_t queueCapacity, std::size_t bufferSize)
+    : bufferSize(bufferSize), blocks(queueCapacity), failed(false), closed(false) {
+    thread = std::thread(&AsyncFileWriter::run, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+}
+
+void AsyncFileWriter::write(const std::string& path, std::vector<char> data) {
+    blocks.push(Block{path, std::move(data)});
+}
+
+bool AsyncFileWriter::close() {
+    if (!closed) {
+        closed = true;
+        blocks.close();
+        thread.join();
+    }
+    return !failed;
+}
+
+void AsyncFileWriter::run() {
+    std::string currentPath;
+    std::FILE* file = nullptr;
+    std::vector<char> buffer(bufferSize);
+    std::unordered_set<std::string> failedPaths; // Paths already reported, whose remaining blocks are dropped
+
+    while (auto block = blocks.pop()) {
+        if (failedPaths.count(block->path) > 0) {
+            continue;
+        }
+
+        if (file == nullptr || block->path != currentPath) {
+            if (file != nullptr && std::fclose(file) != 0) {
+                std::cerr << "Failed to write " << currentPath << std::endl;
+                failed = true;
+            }
+            currentPath = block->path;
+            file = std::fopen(currentPath.c_str(), "wb");
+            if (file == nullptr) {
+                std::cerr << "Failed to open " << currentPath << " for writing" << std::endl;
+                failedPaths.insert(currentPath);
+                failed = true;
+                continue;
+            }
+            std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+        }
+
+        if (!block->data.empty() && std::fwrite(block->data.data(), 1, block->data.size(), file) != block->data.size()) {
+            std::cerr << "Failed to write " << currentPath << std::endl;
+            failedPaths.insert(currentPath);
+            failed = true;
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    if (file != nullptr && std::fclose(file) != 0) {
+        std::cerr << "Failed to write " << currentPath << std::endl;
+        failed = true;
+    }
+}
@@ -0,0 +1,259 @@
+#include "CompressedInput.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef FETA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef FETA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    const std::size_t COMPRESSED_CHUNK_SIZE = 1 << 18; // Bytes of compressed input read at a time
+}
+
+CompressionFormat detectCompression(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    unsigned char magic[4] = {0, 0, 0, 0};
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+
+    if (file.gcount() >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+        return CompressionFormat::Gzip;
+    }
+    if (file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+        return CompressionFormat::Zstd;
+    }
+    return CompressionFormat::None;
+}
+
+bool isCompressionSupported(CompressionFormat format) {
+    switch (format) {
+        case CompressionFormat::None:
+            return true;
+        case CompressionFormat::Gzip:
+#ifdef FETA_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case CompressionFormat::Zstd:
+#ifdef FETA_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+DecompressingStreamBuf::DecompressingStreamBuf(const std::string& filename, CompressionFormat format,
+                                               std::size_t bufferSize, std::size_t bufferCount)
+    : filename(filename), format(format), filledBuffers(bufferCount), emptyBuffers(bufferCount) {
+    for (std::size_t i = 0; i < bufferCount; i++) {
+        emptyBuffers.push(std::vector<char>(bufferSize));
+    }
+
+    setg(nullptr, nullptr, nullptr);
+    if (format == CompressionFormat::Zstd) {
+        thread = std::thread(&DecompressingStreamBuf::decompressZstd, this);
+    } else {
+        thread = std::thread(&DecompressingStreamBuf::decompressGzip, this);
+    }
+}
+
+DecompressingStreamBuf::~DecompressingStreamBuf() {
+    emptyBuffers.close();
+    filledBuffers.close();
+    thread.join();
+}
+
+DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // Hand the finished buffer back to the decompression thread, then wait for the next one
+    if (current.capacity() > 0) {
+        emptyBuffers.push(std::move(current));
+        current = std::vector<char>();
+    }
+
+    auto next = filledBuffers.pop();
+    if (!next) {
+        // Throwing from a stream buffer makes the stream set badbit, so readers see the
+        // damaged file as a read error rather than as the end of a shorter file
+        if (failed) {
+            throw std::ios_base::failure("Failed to decompress " + filename);
+        }
+        return traits_type::eof();
+    }
+    current = std::move(*next);
+    setg(current.data(), current.data(), current.data() + current.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+bool DecompressingStreamBuf::takeEmptyBuffer(std::vector<char>& buffer) {
+    auto empty = emptyBuffers.pop();
+    if (!empty) {
+        return false;
+    }
+    buffer = std::move(*empty);
+    buffer.resize(buffer.capacity());
+    return true;
+}
+
+void DecompressingStreamBuf::decompressGzip() {
+#ifdef FETA_HAVE_ZLIB
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        std::cerr << "Failed to open file" << std::endl;
+        failed = true;
+        filledBuffers.close();
+        return;
+    }
+
+    z_stream stream{};
+    // 15 + 32 lets zlib detect gzip or zlib headers itself
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        std::fclose(file);
+        failed = true;
+        filledBuffers.close();
+        return;
+    }
+
+    std::vector<unsigned char> input(COMPRESSED_CHUNK_SIZE);
+    std::vector<char> output;
+    bool running = takeEmptyBuffer(output);
+    std::size_t produced = 0;
+    int status = Z_OK;
+
+    while (running) {
+        if (stream.avail_in == 0) {
+            stream.avail_in = static_cast<uInt>(std::fread(input.data(), 1, input.size(), file));
+            stream.next_in = input.data();
+            if (stream.avail_in == 0) {
+                if (status != Z_STREAM_END) {
+                    std::cerr << "Compressed file " << filename << " ended unexpectedly" << std::endl;
+                    failed = true;
+                }
+                break;
+            }
+        }
+
+        // Concatenated gzip members are valid, so start over after each one
+        if (status == Z_STREAM_END) {
+            inflateReset(&stream);
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(output.data() + produced);
+        stream.avail_out = static_cast<uInt>(output.size() - produced);
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            std::cerr << "Failed to decompress " << filename << ": " << (stream.msg ? stream.msg : "corrupt data") << std::endl;
+            failed = true;
+            break;
+        }
+        produced = output.size() - stream.avail_out;
+
+        if (produced == output.size()) {
+            running = filledBuffers.push(std::move(output)) && takeEmptyBuffer(output);
+            produced = 0;
+        }
+    }
+
+    if (running && !failed && produced > 0) {
+        output.resize(produced);
+        filledBuffers.push(std::move(output));
+    }
+
+    inflateEnd(&stream);
+    std::fclose(file);
+#else
+    std::cerr << "Cannot read " << filename << ": gzip support was not built in" << std::endl;
+    failed = true;
+#endif
+    filledBuffers.close();
+}
+
+void DecompressingStreamBuf::decompressZstd() {
+#ifdef FETA_HAVE_ZSTD
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        std::cerr << "Failed to open file" << std::endl;
+        failed = true;
+        filledBuffers.close();
+        return;
+    }
+
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    std::vector<char> input(COMPRESSED_CHUNK_SIZE);
+    ZSTD_inBuffer in{input.data(), 0, 0};
+    std::vector<char> output;
+    bool running = takeEmptyBuffer(output);
+    ZSTD_outBuffer out{output.data(), output.size(), 0};
+    std::size_t hint = 1;
+
+    while (running) {
+        if (in.pos == in.size) {
+            in.size = std::fread(input.data(), 1, input.size(), file);
+            in.pos = 0;
+            if (in.size == 0) {
+                if (hint != 0) {
+                    std::cerr << "Compressed file " << filename << " ended unexpectedly" << std::endl;
+                    failed = true;
+                }
+                break;
+            }
+        }
+
+        hint = ZSTD_decompressStream(context, &out, &in);
+        if (ZSTD_isError(hint)) {
+            std::cerr << "Failed to decompress " << filename << ": " << ZSTD_getErrorName(hint) << std::endl;
+            failed = true;
+            break;
+        }
+
+        if (out.pos == out.size) {
+            running = filledBuffers.push(std::move(output)) && takeEmptyBuffer(output);
+            out = ZSTD_outBuffer{output.data(), output.size(), 0};
+        }
+    }
+
+    if (running && !failed && out.pos > 0) {
+        output.resize(out.pos);
+        filledBuffers.push(std::move(output));
+    }
+
+    ZSTD_freeDCtx(context);
+    std::fclose(file);
+#else
+    std::cerr << "Cannot read " << filename << ": zstd support was not built in" << std::endl;
+    failed = true;
+#endif
+    filledBuffers.close();
+}
+
+DecompressingInputStream::DecompressingInputStream(const std::string& filename, CompressionFormat format)
+    : std::istream(nullptr), buffer(filename, format) {
+    rdbuf(&buffer);
+}
+
+std::unique_ptr<std::istream> openInputStream(const std::string& filename) {
+    CompressionFormat format = detectCompression(filename);
+    if (format == CompressionFormat::None) {
+        auto file = std::make_unique<std::ifstream>(filename);
+        if (!file->is_open()) {
+            return nullptr;
+        }
+        return file;
+    }
+
+    if (!isCompressionSupported(format)) {
+        std::cerr << "Compressed input is not supported in this build: " << filename << std::endl;
+        return nullptr;
+    }
+    return std::make_unique<DecompressingInputStream>(filename, format);
+}
@@ -0,0 +1,184 @@
+#include "Contours.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+    bool pointLess(const Point2D& a, const Point2D& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    }
+
+    bool pointEqual(const Point2D& a, const Point2D& b) {
+        return a.x == b.x && a.y == b.y;
+    }
+
+    // Finds an unused line whose key point matches the given point, using a list of line
+    // indices sorted by that key point
+    std::size_t findUnusedLine(const std::vector<std::size_t>& sortedIndices,
+                               const std::vector<Point2D>& keys,
+                               const std::vector<bool>& used,
+                               const Point2D& point) {
+        auto it = std::lower_bound(sortedIndices.begin(), sortedIndices.end(), point,
+                                   [&keys](std::size_t index, const Point2D& p) { return pointLess(keys[index], p); });
+        for (; it != sortedIndices.end() && pointEqual(keys[*it], point); ++it) {
+            if (!used[*it]) {
+                return *it;
+            }
+        }
+        return sortedIndices.size();
+    }
+
+}
+
+std::vector<Contour> stitchContours(const std::vector<Line>& lines) {
+    std::vector<Contour> contours;
+    const std::size_t count = lines.size();
+    if (count == 0) {
+        return contours;
+    }
+
+    std::vector<Point2D> starts(count);
+    std::vector<Point2D> ends(count);
+    for (std::size_t i = 0; i < count; i++) {
+        starts[i] = lines[i].start;
+        ends[i] = lines[i].end;
+    }
+
+    std::vector<std::size_t> byStart(count);
+    std::vector<std::size_t> byEnd(count);
+    for (std::size_t i = 0; i < count; i++) {
+        byStart[i] = i;
+        byEnd[i] = i;
+    }
+    std::sort(byStart.begin(), byStart.end(), [&starts](std::size_t a, std::size_t b) { return pointLess(starts[a], starts[b]); });
+    std::sort(byEnd.begin(), byEnd.end(), [&ends](std::size_t a, std::size_t b) { return pointLess(ends[a], ends[b]); });
+
+    std::vector<bool> used(count, false);
+    for (std::size_t first = 0; first < count; first++) {
+        if (used[first]) {
+            continue;
+        }
+        used[first] = true;
+
+        Contour contour;
+        contour.closed = false;
+        contour.points.push_back(starts[first]);
+        contour.points.push_back(ends[first]);
+
+        // Walk forwards from the end of the chain until it closes or runs out
+        while (true) {
+            std::size_t next = findUnusedLine(byStart, starts, used, contour.points.back());
+            if (next == count) {
+                break;
+            }
+            used[next] = true;
+            if (pointEqual(ends[next], contour.points.front())) {
+                contour.closed = true;
+                break;
+            }
+            contour.points.push_back(ends[next]);
+        }
+
+        // An open chain may also extend backwards from its first point
+        if (!contour.closed) {
+            std::vector<Point2D> prefix;
+            Point2D head = contour.points.front();
+            while (true) {
+                std::size_t previous = findUnusedLine(byEnd, ends, used, head);
+                if (previous == count) {
+                    break;
+                }
+                used[previous] = true;
+                head = starts[previous];
+                prefix.push_back(head);
+            }
+            contour.points.insert(contour.points.begin(), prefix.rbegin(), prefix.rend());
+        }
+
+        contours.push_back(std::move(contour));
+    }
+
+    return contours;
+}
+
+double calculateSignedArea(const Contour& contour) {
+    const std::vector<Point2D>& points = contour.points;
+    const std::size_t n = points.size();
+    if (!contour.closed || n < 3) {
+        return 0.0;
+    }
+
+    // Independent accumulators let the compiler vectorise the cross-product sum
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = 0;
+    for (; i + 4 < n; i += 4) {
+        for (std::size_t k = 0; k < 4; k++) {
+            sums[k] += points[i + k].x * points[i + k + 1].y - points[i + k + 1].x * points[i + k].y;
+        }
+    }
+    for (; i + 1 < n; i++) {
+        sums[0] += points[i].x * points[i + 1].y - points[i + 1].x * points[i].y;
+    }
+    sums[0] += points[n - 1].x * points[0].y - points[0].x * points[n - 1].y;
+
+    return 0.5 * ((sums[0] + sums[1]) + (sums[2] + sums[3]));
+}
+
+double calculateContourLength(const Contour& contour) {
+    const std::vector<Point2D>& points = contour.points;
+    const std::size_t n = points.size();
+    if (n < 2) {
+        return 0.0;
+    }
+
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = 0;
+    for (; i + 4 < n; i += 4) {
+        for (std::size_t k = 0; k < 4; k++) {
+            double dx = points[i + k + 1].x - points[i + k].x;
+            double dy = points[i + k + 1].y - points[i + k].y;
+            sums[k] += std::sqrt(dx * dx + dy * dy);
+        }
+    }
+    for (; i + 1 < n; i++) {
+        double dx = points[i + 1].x - points[i].x;
+        double dy = points[i + 1].y - points[i].y;
+        sums[0] += std::sqrt(dx * dx + dy * dy);
+    }
+    if (contour.closed) {
+        double dx = points[0].x - points[n - 1].x;
+        double dy = points[0].y - points[n - 1].y;
+        sums[0] += std::sqrt(dx * dx + dy * dy);
+    }
+
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+LayerStats calculateLayerStats(const std::vector<Contour>& contours) {
+    LayerStats stats;
+
+    std::vector<double> areas(contours.size());
+    double signedTotal = 0.0;
+    for (std::size_t i = 0; i < contours.size(); i++) {
+        areas[i] = calculateSignedArea(contours[i]);
+        signedTotal += areas[i];
+        stats.perimeter += calculateContourLength(contours[i]);
+    }
+
+    // Outer boundaries share the orientation of the total; a mesh with inverted normals
+    // simply flips every sign
+    for (double area : areas) {
+        if ((signedTotal >= 0.0 && area > 0.0) || (signedTotal < 0.0 && area < 0.0)) {
+            stats.islandCount++;
+        }
+    }
+    stats.area = std::abs(signedTotal);
+
+    return stats;
+}
+
+void buildLayerContours(Layer& layer) {
+    layer.contours = stitchContours(layer.lines);
+    layer.stats = calculateLayerStats(layer.contours);
+}
@@ -0,0 +1,381 @@
+#include "LayerExport.h"
+#include "Contours.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#ifdef FETA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+    const char CONTOUR_MAGIC[8] = {'F', 'E', 'T', 'A', 'C', 'O', 'N', 'T'};
+    const std::uint16_t CONTOUR_VERSION = 1;
+    const std::uint16_t CONTOUR_FLAG_DEFLATE = 1;
+    const std::uint64_t DEFLATE_MAX_RATIO = 1032; // Deflate cannot expand data by more than this
+
+    void appendText(std::vector<char>& out, const char* text) {
+        out.insert(out.end(), text, text + std::strlen(text));
+    }
+
+    void appendPoint(std::vector<char>& out, const char* prefix, const Point2D& point) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%s%.4f %.4f", prefix, point.x, -point.y);
+        appendText(out, text);
+    }
+
+    void appendU16(std::vector<char>& out, std::uint16_t value) {
+        out.push_back(static_cast<char>(value & 0xFF));
+        out.push_back(static_cast<char>(value >> 8));
+    }
+
+    void appendU32(std::vector<char>& out, std::uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void appendF64(std::vector<char>& out, double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; i++) {
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void appendVarint(std::vector<char>& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void appendZigzag(std::vector<char>& out, std::int64_t value) {
+        appendVarint(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    /**
+     * Reads the little-endian and varint fields written above, failing once it runs out of bytes.
+     */
+    struct ByteReader {
+        const unsigned char* data;
+        std::size_t size;
+        std::size_t offset;
+        bool ok;
+
+        std::uint64_t readLittleEndian(int byteCount) {
+            if (offset + byteCount > size) {
+                ok = false;
+                return 0;
+            }
+            std::uint64_t value = 0;
+            for (int i = 0; i < byteCount; i++) {
+                value |= static_cast<std::uint64_t>(data[offset + i]) << (8 * i);
+            }
+            offset += byteCount;
+            return value;
+        }
+
+        double readF64() {
+            std::uint64_t bits = readLittleEndian(8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::uint64_t readVarint() {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (offset >= size) {
+                    ok = false;
+                    return 0;
+                }
+                unsigned char byte = data[offset++];
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            ok = false;
+            return 0;
+        }
+
+        std::int64_t readZigzag() {
+            std::uint64_t value = readVarint();
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+    };
+
+}
+
+SVGExporter::SVGExporter(const std::string& directory)
+    : directory(directory), layerIndex(0) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+}
+
+void SVGExporter::addLayer(const Layer& layer) {
+    // Find the extent of everything drawn, so the view box fits the layer
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    auto include = [&](const Point2D& point) {
+        minX = std::min(minX, point.x);
+        minY = std::min(minY, point.y);
+        maxX = std::max(maxX, point.x);
+        maxY = std::max(maxY, point.y);
+    };
+    for (const auto& contour : layer.contours) {
+        for (const auto& point : contour.points) {
+            include(point);
+        }
+    }
+    for (const auto& line : layer.projectedLines) {
+        include(line.start);
+        include(line.end);
+    }
+    if (minX > maxX) {
+        minX = minY = 0.0;
+        maxX = maxY = 1.0;
+    }
+    double margin = 0.02 * std::max(maxX - minX, maxY - minY) + 0.1;
+
+    std::vector<char> svg;
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"%.4f %.4f %.4f %.4f\">\n"
+                  "<!-- Z = %.4f mm, area = %.4f mm^2, perimeter = %.4f mm, islands = %zu -->\n",
+                  minX - margin, -maxY - margin, (maxX - minX) + 2 * margin, (maxY - minY) + 2 * margin,
+                  layer.height, layer.stats.area, layer.stats.perimeter, layer.stats.islandCount);
+    appendText(svg, text);
+
+    // Closed contours go into one path so even-odd filling cuts the holes out
+    appendText(svg, "<path fill=\"#f5c542\" fill-rule=\"evenodd\" stroke=\"#333\" stroke-width=\"0.05\" d=\"");
+    for (const auto& contour : layer.contours) {
+        if (!contour.closed || contour.points.empty()) {
+            continue;
+        }
+        appendPoint(svg, "M", contour.points[0]);
+        for (std::size_t i = 1; i < contour.points.size(); i++) {
+            appendPoint(svg, " L", contour.points[i]);
+        }
+        appendText(svg, " Z ");
+    }
+    appendText(svg, "\"/>\n");
+
+    for (const auto& contour : layer.contours) {
+        if (contour.closed || contour.points.empty()) {
+            continue;
+        }
+        appendText(svg, "<polyline fill=\"none\" stroke=\"red\" stroke-width=\"0.1\" points=\"");
+        for (const auto& point : contour.points) {
+            appendPoint(svg, " ", point);
+        }
+        appendText(svg, "\"/>\n");
+    }
+
+    // Perimeters are drawn as thin centre lines over the filled cross-section
+    for (const auto& perimeter : layer.perimeters) {
+        appendText(svg, "<path fill=\"none\" stroke=\"#1f5fbf\" stroke-width=\"0.03\" d=\"");
+        for (const auto& loop : perimeter) {
+            if (loop.points.empty()) {
+                continue;
+            }
+            appendPoint(svg, "M", loop.points[0]);
+            for (std::size_t i = 1; i < loop.points.size(); i++) {
+                appendPoint(svg, " L", loop.points[i]);
+            }
+            appendText(svg, " Z ");
+        }
+        appendText(svg, "\"/>\n");
+    }
+
+    if (!layer.projectedLines.empty()) {
+        appendText(svg, "<path fill=\"none\" stroke=\"#999\" stroke-width=\"0.02\" d=\"");
+        for (const auto& line : layer.projectedLines) {
+            appendPoint(svg, "M", line.start);
+            appendPoint(svg, " L", line.end);
+            appendText(svg, " ");
+        }
+        appendText(svg, "\"/>\n");
+    }
+
+    appendText(svg, "</svg>\n");
+
+    std::snprintf(text, sizeof(text), "layer_%05zu.svg", layerIndex++);
+    writer.write((std::filesystem::path(directory) / text).string(), std::move(svg));
+}
+
+bool SVGExporter::finish() {
+    return writer.close();
+}
+
+ContourExporter::ContourExporter(const std::string& path, double resolution, bool compress)
+    : path(path), resolution(resolution), compress(compress && compressionAvailable()) {
+    std::vector<char> header(CONTOUR_MAGIC, CONTOUR_MAGIC + sizeof(CONTOUR_MAGIC));
+    appendU16(header, CONTOUR_VERSION);
+    appendU16(header, this->compress ? CONTOUR_FLAG_DEFLATE : 0);
+    appendF64(header, resolution);
+    writer.write(path, std::move(header));
+}
+
+bool ContourExporter::compressionAvailable() {
+#ifdef FETA_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ContourExporter::addLayer(const Layer& layer) {
+    encoded.clear();
+    appendF64(encoded, layer.height);
+    appendVarint(encoded, layer.contours.size());
+
+    for (const auto& contour : layer.contours) {
+        appendVarint(encoded, (static_cast<std::uint64_t>(contour.points.size()) << 1) | (contour.closed ? 1 : 0));
+
+        std::int64_t previousX = 0;
+        std::int64_t previousY = 0;
+        for (const auto& point : contour.points) {
+            std::int64_t x = std::llround(point.x / resolution);
+            std::int64_t y = std::llround(point.y / resolution);
+            appendZigzag(encoded, x - previousX);
+            appendZigzag(encoded, y - previousY);
+            previousX = x;
+            previousY = y;
+        }
+    }
+
+    std::vector<char> block;
+    appendU32(block, static_cast<std::uint32_t>(encoded.size()));
+#ifdef FETA_HAVE_ZLIB
+    if (compress) {
+        uLongf storedSize = compressBound(encoded.size());
+        block.resize(8 + storedSize);
+        if (compress2(reinterpret_cast<Bytef*>(block.data() + 8), &storedSize,
+                      reinterpret_cast<const Bytef*>(encoded.data()), encoded.size(), Z_DEFAULT_COMPRESSION) == Z_OK) {
+            block.resize(8 + storedSize);
+            std::vector<char> size;
+            appendU32(size, static_cast<std::uint32_t>(storedSize));
+            std::copy(size.begin(), size.end(), block.begin() + 4);
+            writer.write(path, std::move(block));
+            return;
+        }
+        block.resize(4);
+        std::cerr << "Failed to compress layer at Z = " << layer.height << ", storing it uncompressed" << std::endl;
+    }
+#endif
+    // Uncompressed blocks store the same size twice
+    appendU32(block, static_cast<std::uint32_t>(encoded.size()));
+    block.insert(block.end(), encoded.begin(), encoded.end());
+    writer.write(path, std::move(block));
+}
+
+bool ContourExporter::finish() {
+    return writer.close();
+}
+
+bool readContourFile(const std::string& path, const std::function<void(Layer&&)>& onLayer) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file" << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ByteReader header{bytes.data(), bytes.size(), 0, true};
+    if (bytes.size() < 20 || std::memcmp(bytes.data(), CONTOUR_MAGIC, sizeof(CONTOUR_MAGIC)) != 0) {
+        std::cerr << "Not a contour file: " << path << std::endl;
+        return false;
+    }
+    header.offset = sizeof(CONTOUR_MAGIC);
+    std::uint16_t version = static_cast<std::uint16_t>(header.readLittleEndian(2));
+    std::uint16_t flags = static_cast<std::uint16_t>(header.readLittleEndian(2));
+    double resolution = header.readF64();
+    if (version != CONTOUR_VERSION) {
+        std::cerr << "Unsupported contour file version " << version << std::endl;
+        return false;
+    }
+#ifndef FETA_HAVE_ZLIB
+    if (flags & CONTOUR_FLAG_DEFLATE) {
+        std::cerr << "Contour file is compressed but zlib support was not built in" << std::endl;
+        return false;
+    }
+#endif
+
+    std::size_t offset = header.offset;
+    std::vector<unsigned char> decoded;
+    auto malformed = [&path]() {
+        std::cerr << "Malformed contour file: " << path << std::endl;
+        return false;
+    };
+    while (offset < bytes.size()) {
+        ByteReader sizes{bytes.data(), bytes.size(), offset, true};
+        std::uint32_t encodedSize = static_cast<std::uint32_t>(sizes.readLittleEndian(4));
+        std::uint32_t storedSize = static_cast<std::uint32_t>(sizes.readLittleEndian(4));
+        if (!sizes.ok || storedSize > bytes.size() - sizes.offset) {
+            return malformed();
+        }
+        const unsigned char* stored = bytes.data() + sizes.offset;
+        offset = sizes.offset + storedSize;
+
+        // Check the sizes before trusting them: stored blocks hold exactly the encoded bytes, and
+        // deflated ones cannot inflate past deflate's ratio
+        const unsigned char* block = stored;
+        if (flags & CONTOUR_FLAG_DEFLATE) {
+            if (encodedSize > DEFLATE_MAX_RATIO * storedSize) {
+                return malformed();
+            }
+#ifdef FETA_HAVE_ZLIB
+            decoded.resize(encodedSize);
+            uLongf decodedSize = encodedSize;
+            if (uncompress(decoded.data(), &decodedSize, stored, storedSize) != Z_OK || decodedSize != encodedSize) {
+                return malformed();
+            }
+            block = decoded.data();
+#endif
+        } else if (encodedSize != storedSize) {
+            return malformed();
+        }
+
+        ByteReader reader{block, encodedSize, 0, true};
+        Layer layer;
+        layer.height = reader.readF64();
+        std::uint64_t contourCount = reader.readVarint();
+        for (std::uint64_t c = 0; c < contourCount && reader.ok; c++) {
+            std::uint64_t countAndClosed = reader.readVarint();
+            Contour contour{std::vector<Point2D>(), (countAndClosed & 1) != 0};
+            std::uint64_t pointCount = countAndClosed >> 1;
+            if (pointCount > encodedSize) {
+                return malformed();
+            }
+            contour.points.reserve(pointCount);
+
+            std::int64_t x = 0;
+            std::int64_t y = 0;
+            for (std::uint64_t p = 0; p < pointCount && reader.ok; p++) {
+                x += reader.readZigzag();
+                y += reader.readZigzag();
+                contour.points.push_back(Point2D{x * resolution, y * resolution});
+            }
+            layer.contours.push_back(std::move(contour));
+        }
+        if (!reader.ok) {
+            return malformed();
+        }
+
+        layer.stats = calculateLayerStats(layer.contours);
+        onLayer(std::move(layer));
+    }
+
+    return true;
+}
@@ -0,0 +1,297 @@
+#include "MeshDecimator.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    const int KEY_BITS = 21; // Bits per axis in a cell key
+    const std::size_t TRIANGLES_PER_CHUNK = 16384; // Smallest amount of work handed to one thread
+    const double MIN_TRIANGLE_AREA = 1e-6; // Matches the degenerate triangle check in STLReader
+
+    // Spreads cell keys evenly over the hash partitions
+    std::uint64_t mixKey(std::uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    /**
+     * Sum of the area-weighted plane quadrics around a cluster, plus the data for its mean vertex.
+     */
+    struct Cluster {
+        std::array<double, 10> quadric{}; // aa, ab, ac, ad, bb, bc, bd, cc, cd, dd
+        Point3D positionSum{0, 0, 0};
+        std::size_t count = 0;
+        std::uint64_t key = 0;
+    };
+
+    /**
+     * A facet plane as unit normal (a, b, c) and offset d, weighted by the facet area.
+     */
+    struct Plane {
+        double a, b, c, d, weight;
+    };
+}
+
+MeshDecimator::MeshDecimator(const STLReader& stlReader)
+    : stlReader(stlReader), threadCount(0) {}
+
+void MeshDecimator::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+double MeshDecimator::minimumCellSize() const {
+    Point3D extent = stlReader.getMaximumBoundingBox() - stlReader.getMinimumBoundingBox();
+    double largest = std::max({extent.x, extent.y, extent.z});
+    return std::max(largest / ((1 << KEY_BITS) - 2), 1e-9);
+}
+
+std::uint64_t MeshDecimator::cellKey(const Point3D& point, double cellSize) const {
+    const Point3D minBound = stlReader.getMinimumBoundingBox();
+    const std::uint64_t mask = (1ULL << KEY_BITS) - 1;
+    std::uint64_t ix = static_cast<std::uint64_t>((point.x - minBound.x) / cellSize) & mask;
+    std::uint64_t iy = static_cast<std::uint64_t>((point.y - minBound.y) / cellSize) & mask;
+    std::uint64_t iz = static_cast<std::uint64_t>((point.z - minBound.z) / cellSize) & mask;
+    return (ix << (2 * KEY_BITS)) | (iy << KEY_BITS) | iz;
+}
+
+std::size_t MeshDecimator::countSurvivingTriangles(double cellSize) const {
+    const auto& triangles = stlReader.getTriangles();
+    std::size_t chunkCount = (triangles.size() + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK;
+    std::vector<std::size_t> counts(chunkCount, 0);
+
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t end = std::min(triangles.size(), (chunk + 1) * TRIANGLES_PER_CHUNK);
+        std::size_t count = 0;
+        for (std::size_t t = chunk * TRIANGLES_PER_CHUNK; t < end; t++) {
+            std::uint64_t k0 = cellKey(triangles[t].vertices[0], cellSize);
+            std::uint64_t k1 = cellKey(triangles[t].vertices[1], cellSize);
+            std::uint64_t k2 = cellKey(triangles[t].vertices[2], cellSize);
+            count += (k0 != k1 && k1 != k2 && k2 != k0) ? 1 : 0;
+        }
+        counts[chunk] = count;
+    });
+
+    std::size_t total = 0;
+    for (std::size_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+std::vector<Triangle> MeshDecimator::decimateToCount(std::size_t targetTriangleCount) const {
+    const auto& triangles = stlReader.getTriangles();
+    if (triangles.size() <= targetTriangleCount) {
+        return triangles;
+    }
+
+    // Bisect the cell size on a log scale for the finest grid that meets the target
+    Point3D extent = stlReader.getMaximumBoundingBox() - stlReader.getMinimumBoundingBox();
+    double low = minimumCellSize();
+    double high = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+    for (int iteration = 0; iteration < 24; iteration++) {
+        double middle = std::sqrt(low * high);
+        if (countSurvivingTriangles(middle) > targetTriangleCount) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    // Thin parts can vanish in a single step, and overshooting the target beats an empty model
+    if (countSurvivingTriangles(high) == 0) {
+        return decimateWithCellSize(low);
+    }
+    return decimateWithCellSize(high);
+}
+
+std::vector<Triangle> MeshDecimator::decimateToError(double maxError) const {
+    // A vertex stays inside its cell, so it moves at most one cell diagonal
+    return decimateWithCellSize(maxError / std::sqrt(3.0));
+}
+
+std::vector<Triangle> MeshDecimator::decimateWithCellSize(double cellSize) const {
+    const auto& triangles = stlReader.getTriangles();
+    const std::size_t triangleCount = triangles.size();
+    const std::size_t cornerCount = triangleCount * 3;
+    cellSize = std::max(cellSize, minimumCellSize());
+
+    const std::size_t chunkCount = std::max<std::size_t>(1, (triangleCount + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK);
+    const std::size_t partitionCount = resolveThreadCount(threadCount) * 8;
+    auto chunkEnd = [&](std::size_t chunk) { return std::min(triangleCount, (chunk + 1) * TRIANGLES_PER_CHUNK); };
+
+    // Pass 1: facet planes, corner cell keys and the number of corners each chunk sends to each partition
+    std::vector<Plane> planes(triangleCount);
+    std::vector<std::uint64_t> keys(cornerCount);
+    std::vector<std::size_t> partitionCounts(chunkCount * partitionCount, 0);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t* counts = &partitionCounts[chunk * partitionCount];
+        for (std::size_t t = chunk * TRIANGLES_PER_CHUNK; t < chunkEnd(chunk); t++) {
+            const Triangle& triangle = triangles[t];
+            Point3D e1 = triangle.vertices[1] - triangle.vertices[0];
+            Point3D e2 = triangle.vertices[2] - triangle.vertices[0];
+            double nx = e1.y * e2.z - e1.z * e2.y;
+            double ny = e1.z * e2.x - e1.x * e2.z;
+            double nz = e1.x * e2.y - e1.y * e2.x;
+            double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+            if (length > 0) {
+                nx /= length;
+                ny /= length;
+                nz /= length;
+            }
+            const Point3D& p = triangle.vertices[0];
+            planes[t] = Plane{nx, ny, nz, -(nx * p.x + ny * p.y + nz * p.z), 0.5 * length};
+
+            for (int v = 0; v < 3; v++) {
+                std::uint64_t key = cellKey(triangle.vertices[v], cellSize);
+                keys[t * 3 + v] = key;
+                counts[mixKey(key) % partitionCount]++;
+            }
+        }
+    });
+
+    // Lay the partitions out one after another, each chunk writing to its own slice
+    std::vector<std::size_t> partitionStart(partitionCount + 1, 0);
+    std::vector<std::size_t> writeOffsets(chunkCount * partitionCount);
+    std::size_t offset = 0;
+    for (std::size_t p = 0; p < partitionCount; p++) {
+        partitionStart[p] = offset;
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++) {
+            writeOffsets[chunk * partitionCount + p] = offset;
+            offset += partitionCounts[chunk * partitionCount + p];
+        }
+    }
+    partitionStart[partitionCount] = offset;
+
+    std::vector<std::size_t> partitionCorners(cornerCount);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t* offsets = &writeOffsets[chunk * partitionCount];
+        for (std::size_t c = chunk * TRIANGLES_PER_CHUNK * 3; c < chunkEnd(chunk) * 3; c++) {
+            partitionCorners[offsets[mixKey(keys[c]) % partitionCount]++] = c;
+        }
+    });
+
+    // Pass 2: each partition merges its corners into clusters and accumulates their quadrics
+    std::vector<std::vector<Cluster>> partitionClusters(partitionCount);
+    std::vector<std::uint32_t> localIds(cornerCount);
+    parallelFor(partitionCount, threadCount, [&](std::size_t p) {
+        std::unordered_map<std::uint64_t, std::uint32_t> clusterIds;
+        clusterIds.reserve((partitionStart[p + 1] - partitionStart[p]) / 4 + 1);
+        std::vector<Cluster>& clusters = partitionClusters[p];
+
+        for (std::size_t i = partitionStart[p]; i < partitionStart[p + 1]; i++) {
+            std::size_t corner = partitionCorners[i];
+            auto inserted = clusterIds.emplace(keys[corner], static_cast<std::uint32_t>(clusters.size()));
+            if (inserted.second) {
+                clusters.emplace_back();
+                clusters.back().key = keys[corner];
+            }
+            localIds[corner] = inserted.first->second;
+
+            Cluster& cluster = clusters[inserted.first->second];
+            const Plane& plane = planes[corner / 3];
+            const double q[4] = {plane.a, plane.b, plane.c, plane.d};
+            std::size_t k = 0;
+            for (int r = 0; r < 4; r++) {
+                for (int c = r; c < 4; c++) {
+                    cluster.quadric[k++] += plane.weight * q[r] * q[c];
+                }
+            }
+            const Point3D& vertex = triangles[corner / 3].vertices[corner % 3];
+            cluster.positionSum = cluster.positionSum + vertex;
+            cluster.count++;
+        }
+    });
+
+    std::vector<std::size_t> clusterStart(partitionCount + 1, 0);
+    for (std::size_t p = 0; p < partitionCount; p++) {
+        clusterStart[p + 1] = clusterStart[p] + partitionClusters[p].size();
+    }
+
+    // Place each merged vertex at its quadric minimum, if that lies inside its cell
+    const Point3D minBound = stlReader.getMinimumBoundingBox();
+    const std::uint64_t mask = (1ULL << KEY_BITS) - 1;
+    std::vector<Point3D> positions(clusterStart[partitionCount]);
+    parallelFor(partitionCount, threadCount, [&](std::size_t p) {
+        for (std::size_t i = 0; i < partitionClusters[p].size(); i++) {
+            const Cluster& cluster = partitionClusters[p][i];
+            const auto& q = cluster.quadric;
+            Point3D mean = cluster.positionSum * (1.0 / cluster.count);
+            Point3D placed = mean;
+
+            // Solve A x = -b by Cramer's rule, with A = [[aa ab ac] [ab bb bc] [ac bc cc]] and b = [ad bd cd]
+            double det = q[0] * (q[4] * q[7] - q[5] * q[5]) - q[1] * (q[1] * q[7] - q[5] * q[2]) + q[2] * (q[1] * q[5] - q[4] * q[2]);
+            double trace = q[0] + q[4] + q[7];
+            if (std::abs(det) > 1e-6 * trace * trace * trace) {
+                double bx = -q[3], by = -q[6], bz = -q[8];
+                Point3D solved{
+                    (bx * (q[4] * q[7] - q[5] * q[5]) - q[1] * (by * q[7] - q[5] * bz) + q[2] * (by * q[5] - q[4] * bz)) / det,
+                    (q[0] * (by * q[7] - bz * q[5]) - bx * (q[1] * q[7] - q[5] * q[2]) + q[2] * (q[1] * bz - by * q[2])) / det,
+                    (q[0] * (q[4] * bz - q[5] * by) - q[1] * (q[1] * bz - by * q[2]) + bx * (q[1] * q[5] - q[4] * q[2])) / det
+                };
+
+                Point3D cellMin{
+                    minBound.x + ((cluster.key >> (2 * KEY_BITS)) & mask) * cellSize,
+                    minBound.y + ((cluster.key >> KEY_BITS) & mask) * cellSize,
+                    minBound.z + (cluster.key & mask) * cellSize
+                };
+                if (solved.x >= cellMin.x && solved.x <= cellMin.x + cellSize &&
+                    solved.y >= cellMin.y && solved.y <= cellMin.y + cellSize &&
+                    solved.z >= cellMin.z && solved.z <= cellMin.z + cellSize) {
+                    placed = solved;
+                }
+            }
+            positions[clusterStart[p] + i] = placed;
+        }
+    });
+
+    // Pass 3: rebuild the facets on the merged vertices, dropping collapsed ones
+    std::vector<std::vector<std::array<std::size_t, 3>>> chunkFaces(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        for (std::size_t t = chunk * TRIANGLES_PER_CHUNK; t < chunkEnd(chunk); t++) {
+            std::array<std::size_t, 3> ids;
+            for (int v = 0; v < 3; v++) {
+                std::size_t corner = t * 3 + v;
+                ids[v] = clusterStart[mixKey(keys[corner]) % partitionCount] + localIds[corner];
+            }
+            if (ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0]) {
+                continue;
+            }
+            // Rotate the smallest ID to the front, keeping the winding, so duplicates compare equal
+            std::rotate(ids.begin(), std::min_element(ids.begin(), ids.end()), ids.end());
+            chunkFaces[chunk].push_back(ids);
+        }
+    });
+
+    std::vector<std::array<std::size_t, 3>> faces;
+    for (auto& chunk : chunkFaces) {
+        faces.insert(faces.end(), chunk.begin(), chunk.end());
+    }
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+
+    std::vector<Triangle> decimated;
+    decimated.reserve(faces.size());
+    for (const auto& face : faces) {
+        Triangle triangle;
+        for (int v = 0; v < 3; v++) {
+            triangle.vertices[v] = positions[face[v]];
+        }
+        Point3D e1 = triangle.vertices[1] - triangle.vertices[0];
+        Point3D e2 = triangle.vertices[2] - triangle.vertices[0];
+        Vector3D cross{e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+        double length = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+        if (0.5 * length < MIN_TRIANGLE_AREA) {
+            continue;
+        }
+        triangle.normal = cross * (1.0 / length);
+        decimated.push_back(triangle);
+    }
+
+    return decimated;
+}
@@ -0,0 +1,89 @@
+#include "OrientationOptimizer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+OrientationOptimizer::OrientationOptimizer(const STLReader& stlReader)
+    : analyzer(stlReader),
+      surfaceArea(stlReader.getTotalSurfaceArea() > 0 ? stlReader.getTotalSurfaceArea() : 1.0),
+      threadCount(0),
+      candidateCount(256) {
+    // Candidates are evaluated in parallel, so each analysis runs on a single thread
+    analyzer.setThreadCount(1);
+}
+
+void OrientationOptimizer::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+void OrientationOptimizer::setCandidateCount(std::size_t candidateCount) {
+    this->candidateCount = candidateCount;
+}
+
+void OrientationOptimizer::setWeights(const OrientationWeights& weights) {
+    this->weights = weights;
+}
+
+OrientationResult OrientationOptimizer::findBestOrientation(double layerHeight, double criticalAngle) const {
+    // The current orientation comes first so it wins any tie, then the other axis directions,
+    // then a Fibonacci spiral for an even spread over the sphere
+    std::vector<Vector3D> directions = {
+        {0, 0, 1}, {0, 0, -1}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}
+    };
+    const double goldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+    for (std::size_t i = 0; i < candidateCount; i++) {
+        double z = 1.0 - 2.0 * (i + 0.5) / candidateCount;
+        double radius = std::sqrt(1.0 - z * z);
+        double theta = goldenAngle * i;
+        directions.push_back(Vector3D{radius * std::cos(theta), radius * std::sin(theta), z});
+    }
+
+    std::vector<OverhangReport> reports(directions.size());
+    parallelFor(directions.size(), threadCount, [&](std::size_t i) {
+        reports[i] = analyzer.analyze(directions[i], criticalAngle, false);
+    });
+
+    double tallest = 0.0;
+    for (const auto& report : reports) {
+        tallest = std::max(tallest, report.height);
+    }
+    if (tallest <= 0.0) {
+        tallest = 1.0;
+    }
+
+    std::size_t best = 0;
+    std::vector<double> scores(directions.size());
+    for (std::size_t i = 0; i < directions.size(); i++) {
+        scores[i] = weights.layers * reports[i].height / tallest
+                  + weights.overhang * reports[i].projectedArea / surfaceArea
+                  - weights.baseContact * reports[i].baseContactArea / surfaceArea;
+        if (scores[i] < scores[best]) {
+            best = i;
+        }
+    }
+
+    OrientationResult result;
+    result.buildDirection = directions[best];
+    result.score = scores[best];
+    result.layerCount = static_cast<std::size_t>(std::ceil(reports[best].height / layerHeight));
+    result.report = reports[best];
+
+    // The rotation taking the build direction onto +Z turns about their cross product
+    const Vector3D& d = result.buildDirection;
+    Vector3D axis{d.y, -d.x, 0.0};
+    double sine = std::sqrt(axis.x * axis.x + axis.y * axis.y);
+    if (sine < 1e-12) {
+        result.rotationAxis = Vector3D{1, 0, 0};
+        result.rotationAngle = d.z > 0 ? 0.0 : 180.0;
+    } else {
+        result.rotationAxis = axis * (1.0 / sine);
+        result.rotationAngle = std::atan2(sine, d.z) * 180.0 / M_PI;
+    }
+
+    return result;
+}
+
+void OrientationOptimizer::applyOrientation(STLReader& stlReader, const OrientationResult& result) {
+    stlReader.rotateModel(result.rotationAxis, result.rotationAngle);
+}
@@ -0,0 +1,251 @@
+#include "OutOfCoreSlicer.h"
+#include "Contours.h"
+#include "Parallel.h"
+#include "Slicer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+    const std::size_t BAND_FLUSH_SIZE = 1024; // Triangles buffered per band before appending to its file
+    const std::size_t MAX_OPEN_BAND_FILES = 64; // Band files kept open at once, well under typical descriptor limits
+}
+
+OutOfCoreSlicer::OutOfCoreSlicer(double layerHeight, std::size_t layersPerBand, const std::string& tempDirectory)
+    : layerHeight(layerHeight),
+      layersPerBand(layersPerBand > 0 ? layersPerBand : 1),
+      tempDirectory(tempDirectory),
+      threadCount(0),
+      perimeterGenerator(nullptr),
+      triangleCount(0),
+      largestBandSize(0) {}
+
+void OutOfCoreSlicer::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+void OutOfCoreSlicer::setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator) {
+    this->perimeterGenerator = perimeterGenerator;
+}
+
+void OutOfCoreSlicer::setZHeight(double desiredZHeight) {
+    zHeight = desiredZHeight;
+}
+
+std::size_t OutOfCoreSlicer::getTriangleCount() const {
+    return triangleCount;
+}
+
+std::size_t OutOfCoreSlicer::getLargestBandSize() const {
+    return largestBandSize;
+}
+
+bool OutOfCoreSlicer::flushBand(std::vector<Band>& bands, std::size_t index) {
+    Band& band = bands[index];
+    if (band.pending.empty()) {
+        return true;
+    }
+
+    bool written = true;
+    if (!band.file) {
+        if (openBands.size() == MAX_OPEN_BAND_FILES) {
+            Band& oldest = bands[openBands.front()];
+            oldest.file->close();
+            written = !oldest.file->fail();
+            oldest.file.reset();
+            openBands.pop_front();
+        }
+        band.file = std::make_unique<std::ofstream>(band.path, std::ios::binary | std::ios::app);
+        openBands.push_back(index);
+    }
+
+    band.file->write(reinterpret_cast<const char*>(band.pending.data()),
+                     static_cast<std::streamsize>(band.pending.size() * sizeof(Triangle)));
+    band.pending.clear();
+    return band.file->good() && written;
+}
+
+bool OutOfCoreSlicer::closeBands(std::vector<Band>& bands) {
+    bool written = true;
+    for (std::size_t index : openBands) {
+        bands[index].file->close();
+        written = !bands[index].file->fail() && written;
+        bands[index].file.reset();
+    }
+    openBands.clear();
+    return written;
+}
+
+bool OutOfCoreSlicer::loadBand(const Band& band, std::vector<Triangle>& triangles) const {
+    triangles.resize(band.triangleCount);
+    if (band.triangleCount == 0) {
+        return true;
+    }
+
+    std::ifstream file(band.path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(triangles.data()),
+              static_cast<std::streamsize>(triangles.size() * sizeof(Triangle)));
+    return file.good();
+}
+
+std::vector<Layer> OutOfCoreSlicer::sliceBand(std::vector<Triangle> triangles, std::size_t firstLayer, std::size_t layerCount) const {
+    STLReader bandReader;
+    bandReader.setTriangles(std::move(triangles));
+    // Bands are already sliced in parallel, so each builds its index on its own thread
+    Slicer slicer(bandReader, layerHeight, 1);
+
+    std::vector<Layer> layers(layerCount);
+    std::size_t triangleIndex = 0;
+    for (std::size_t i = 0; i < layerCount; i++) {
+        layers[i].height = (firstLayer + i) * layerHeight;
+        slicer.sliceLayer(layers[i].height, triangleIndex, layers[i]);
+        buildLayerContours(layers[i]);
+        if (perimeterGenerator) {
+            perimeterGenerator->generateLayer(layers[i]);
+        }
+    }
+    return layers;
+}
+
+bool OutOfCoreSlicer::run(const std::string& filename, const LayerSink& sink) {
+    triangleCount = 0;
+    largestBandSize = 0;
+
+    STLReader reader;
+
+    double zTranslation = 0.0;
+    if (zHeight.has_value()) {
+        double modelMinZ = std::numeric_limits<double>::max();
+        double modelMaxZ;
+        if (!reader.scanFacetMinZ(filename, [&modelMinZ](double minZ) { modelMinZ = std::min(modelMinZ, minZ); }, modelMaxZ)) {
+            return false;
+        }
+        zTranslation = zHeight.value() - modelMinZ;
+    }
+
+    std::filesystem::path bandDirectory = tempDirectory.empty() ? std::filesystem::temp_directory_path()
+                                                                : std::filesystem::path(tempDirectory);
+    bandDirectory /= "feta_bands_" + std::to_string(std::random_device{}());
+    std::error_code error;
+    std::filesystem::create_directories(bandDirectory, error);
+    if (error) {
+        std::cerr << "Failed to create band directory " << bandDirectory << std::endl;
+        return false;
+    }
+
+    // Partition: append each triangle to every band holding a layer it spans
+    std::vector<Band> bands;
+    bool written = true;
+    bool loaded = reader.streamSTL(filename, [&](const Triangle& triangle) {
+        Triangle placed = triangle;
+        for (auto& vertex : placed.vertices) {
+            vertex.z += zTranslation;
+        }
+        triangleCount++;
+
+        double minZ = std::min({placed.vertices[0].z, placed.vertices[1].z, placed.vertices[2].z});
+        double maxZ = std::max({placed.vertices[0].z, placed.vertices[1].z, placed.vertices[2].z});
+        if (maxZ < 0.0) {
+            return;  // Below the first layer
+        }
+
+        // Find the layers the triangle can reach, minZ <= i * layerHeight <= maxZ, computing the
+        // layer heights exactly as sliceBand does so triangles on a layer are kept
+        double firstLayer = std::ceil(minZ / layerHeight);
+        if (firstLayer > 0.0 && (firstLayer - 1.0) * layerHeight >= minZ) {
+            firstLayer -= 1.0;
+        } else if (firstLayer * layerHeight < minZ) {
+            firstLayer += 1.0;
+        }
+        double lastLayer = std::floor(maxZ / layerHeight);
+        if ((lastLayer + 1.0) * layerHeight <= maxZ) {
+            lastLayer += 1.0;
+        } else if (lastLayer * layerHeight > maxZ) {
+            lastLayer -= 1.0;
+        }
+        firstLayer = std::max(0.0, firstLayer);
+        if (firstLayer > lastLayer) {
+            return;  // Fits between two layers, so no layer crosses it
+        }
+
+        std::size_t firstBand = static_cast<std::size_t>(firstLayer) / layersPerBand;
+        std::size_t lastBand = static_cast<std::size_t>(lastLayer) / layersPerBand;
+        if (lastBand >= bands.size()) {
+            std::size_t oldSize = bands.size();
+            bands.resize(lastBand + 1);
+            for (std::size_t b = oldSize; b < bands.size(); b++) {
+                bands[b].path = (bandDirectory / ("band_" + std::to_string(b) + ".bin")).string();
+                bands[b].triangleCount = 0;
+            }
+        }
+
+        for (std::size_t b = firstBand; b <= lastBand; b++) {
+            bands[b].pending.push_back(placed);
+            bands[b].triangleCount++;
+            if (bands[b].pending.size() == BAND_FLUSH_SIZE) {
+                written = flushBand(bands, b) && written;
+            }
+        }
+    });
+    for (std::size_t b = 0; b < bands.size(); b++) {
+        written = flushBand(bands, b) && written;
+        bands[b].pending.shrink_to_fit();
+    }
+    written = closeBands(bands) && written;
+
+    if (!loaded || !written || triangleCount == 0) {
+        if (!written) {
+            std::cerr << "Failed to write band files to " << bandDirectory << std::endl;
+        }
+        std::filesystem::remove_all(bandDirectory, error);
+        return false;
+    }
+
+    double modelHeight = reader.getMaximumBoundingBox().z - reader.getMinimumBoundingBox().z;
+    std::size_t numLayers = static_cast<std::size_t>(std::max(0.0, ceil(modelHeight / layerHeight)));
+    std::size_t numBands = (numLayers + layersPerBand - 1) / layersPerBand;
+
+    // Slice: load and slice a round of bands concurrently, then hand the layers on in order
+    std::size_t bandsInFlight = resolveThreadCount(threadCount);
+    std::atomic<bool> failed{false};
+    for (std::size_t roundStart = 0; roundStart < numBands && !failed; roundStart += bandsInFlight) {
+        std::size_t roundSize = std::min(bandsInFlight, numBands - roundStart);
+        std::vector<std::vector<Layer>> results(roundSize);
+
+        parallelFor(roundSize, roundSize, [&](std::size_t k) {
+            std::size_t b = roundStart + k;
+            std::size_t firstLayer = b * layersPerBand;
+            std::size_t layerCount = std::min(layersPerBand, numLayers - firstLayer);
+
+            std::vector<Triangle> triangles;
+            if (b < bands.size() && !loadBand(bands[b], triangles)) {
+                failed = true;
+                return;
+            }
+            results[k] = sliceBand(std::move(triangles), firstLayer, layerCount);
+        });
+
+        for (std::size_t k = 0; k < roundSize; k++) {
+            std::size_t b = roundStart + k;
+            if (b < bands.size()) {
+                largestBandSize = std::max(largestBandSize, bands[b].triangleCount);
+                std::filesystem::remove(bands[b].path, error);
+            }
+            for (auto& layer : results[k]) {
+                sink(std::move(layer));
+            }
+        }
+    }
+
+    std::filesystem::remove_all(bandDirectory, error);
+
+    if (failed) {
+        std::cerr << "Failed to read band files from " << bandDirectory << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,275 @@
+#include "OverhangAnalyzer.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+    const double BASE_TOLERANCE = 1e-3; // Facets within this height of the lowest point rest on the plate
+    const std::size_t FACETS_PER_CHUNK = 16384; // Smallest amount of work handed to one thread
+
+    Vector3D crossProduct(const Vector3D& a, const Vector3D& b) {
+        return Vector3D{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    double dotProduct(const Vector3D& a, const Vector3D& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    std::size_t findRoot(std::vector<std::size_t>& parents, std::size_t i) {
+        while (parents[i] != i) {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+        return i;
+    }
+}
+
+OverhangAnalyzer::OverhangAnalyzer(const STLReader& stlReader)
+    : facetCount(stlReader.getTriangles().size()), threadCount(0) {
+    const auto& triangles = stlReader.getTriangles();
+
+    facets.normalX.resize(facetCount);
+    facets.normalY.resize(facetCount);
+    facets.normalZ.resize(facetCount);
+    facets.area.resize(facetCount);
+    for (int v = 0; v < 3; v++) {
+        facets.vertexX[v].resize(facetCount);
+        facets.vertexY[v].resize(facetCount);
+        facets.vertexZ[v].resize(facetCount);
+    }
+
+    for (std::size_t i = 0; i < facetCount; i++) {
+        const Triangle& triangle = triangles[i];
+        facets.normalX[i] = triangle.normal.x;
+        facets.normalY[i] = triangle.normal.y;
+        facets.normalZ[i] = triangle.normal.z;
+
+        Vector3D edge1{triangle.vertices[1].x - triangle.vertices[0].x,
+                       triangle.vertices[1].y - triangle.vertices[0].y,
+                       triangle.vertices[1].z - triangle.vertices[0].z};
+        Vector3D edge2{triangle.vertices[2].x - triangle.vertices[0].x,
+                       triangle.vertices[2].y - triangle.vertices[0].y,
+                       triangle.vertices[2].z - triangle.vertices[0].z};
+        Vector3D cross = crossProduct(edge1, edge2);
+        facets.area[i] = 0.5 * std::sqrt(dotProduct(cross, cross));
+
+        for (int v = 0; v < 3; v++) {
+            facets.vertexX[v][i] = triangle.vertices[v].x;
+            facets.vertexY[v][i] = triangle.vertices[v].y;
+            facets.vertexZ[v][i] = triangle.vertices[v].z;
+        }
+    }
+}
+
+void OverhangAnalyzer::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+OverhangReport OverhangAnalyzer::analyze(const Vector3D& buildDirection, double criticalAngle, bool findRegions) const {
+    OverhangReport report;
+
+    double length = std::sqrt(dotProduct(buildDirection, buildDirection));
+    if (facetCount == 0 || length == 0.0) {
+        return report;
+    }
+    const double dx = buildDirection.x / length;
+    const double dy = buildDirection.y / length;
+    const double dz = buildDirection.z / length;
+    const double overhangLimit = -std::sin(criticalAngle * M_PI / 180.0);
+
+    std::size_t chunkCount = std::min((facetCount + FACETS_PER_CHUNK - 1) / FACETS_PER_CHUNK,
+                                      resolveThreadCount(threadCount) * 4);
+    auto chunkBegin = [&](std::size_t chunk) { return facetCount * chunk / chunkCount; };
+
+    // First pass: the extent of the model along the build direction
+    std::vector<double> chunkMin(chunkCount, std::numeric_limits<double>::max());
+    std::vector<double> chunkMax(chunkCount, std::numeric_limits<double>::lowest());
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        const std::size_t begin = chunkBegin(chunk);
+        const std::size_t end = chunkBegin(chunk + 1);
+        double low = std::numeric_limits<double>::max();
+        double high = std::numeric_limits<double>::lowest();
+        for (int v = 0; v < 3; v++) {
+            const double* x = facets.vertexX[v].data();
+            const double* y = facets.vertexY[v].data();
+            const double* z = facets.vertexZ[v].data();
+            #pragma omp simd reduction(min:low) reduction(max:high)
+            for (std::size_t i = begin; i < end; i++) {
+                double h = x[i] * dx + y[i] * dy + z[i] * dz;
+                low = std::min(low, h);
+                high = std::max(high, h);
+            }
+        }
+        chunkMin[chunk] = low;
+        chunkMax[chunk] = high;
+    });
+    const double baseHeight = *std::min_element(chunkMin.begin(), chunkMin.end());
+    report.height = *std::max_element(chunkMax.begin(), chunkMax.end()) - baseHeight;
+
+    // Second pass: classify every facet and sum the areas, branch-free so it vectorises
+    std::vector<unsigned char> overhangFlags(facetCount);
+    std::vector<std::array<double, 5>> chunkSums(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        const std::size_t begin = chunkBegin(chunk);
+        const std::size_t end = chunkBegin(chunk + 1);
+        const double* nx = facets.normalX.data();
+        const double* ny = facets.normalY.data();
+        const double* nz = facets.normalZ.data();
+        const double* area = facets.area.data();
+        const double* x0 = facets.vertexX[0].data();
+        const double* y0 = facets.vertexY[0].data();
+        const double* z0 = facets.vertexZ[0].data();
+        const double* x1 = facets.vertexX[1].data();
+        const double* y1 = facets.vertexY[1].data();
+        const double* z1 = facets.vertexZ[1].data();
+        const double* x2 = facets.vertexX[2].data();
+        const double* y2 = facets.vertexY[2].data();
+        const double* z2 = facets.vertexZ[2].data();
+        unsigned char* flags = overhangFlags.data();
+
+        double count = 0.0, overhangArea = 0.0, projectedArea = 0.0, supportVolume = 0.0, baseArea = 0.0;
+        #pragma omp simd reduction(+:count, overhangArea, projectedArea, supportVolume, baseArea)
+        for (std::size_t i = begin; i < end; i++) {
+            double facing = nx[i] * dx + ny[i] * dy + nz[i] * dz;
+            double h0 = x0[i] * dx + y0[i] * dy + z0[i] * dz;
+            double h1 = x1[i] * dx + y1[i] * dy + z1[i] * dz;
+            double h2 = x2[i] * dx + y2[i] * dy + z2[i] * dz;
+            double top = std::max(h0, std::max(h1, h2));
+            double centroidHeight = (h0 + h1 + h2) * (1.0 / 3.0) - baseHeight;
+
+            bool onBase = top <= baseHeight + BASE_TOLERANCE;
+            bool overhang = facing < overhangLimit && !onBase;
+            double projected = area[i] * -facing;
+
+            flags[i] = overhang;
+            count += overhang ? 1.0 : 0.0;
+            overhangArea += overhang ? area[i] : 0.0;
+            projectedArea += overhang ? projected : 0.0;
+            supportVolume += overhang ? projected * centroidHeight : 0.0;
+            baseArea += (onBase && facing < 0.0) ? area[i] : 0.0;
+        }
+        chunkSums[chunk] = {count, overhangArea, projectedArea, supportVolume, baseArea};
+    });
+
+    for (const auto& sums : chunkSums) {
+        report.overhangTriangleCount += static_cast<std::size_t>(sums[0]);
+        report.overhangArea += sums[1];
+        report.projectedArea += sums[2];
+        report.supportVolume += sums[3];
+        report.baseContactArea += sums[4];
+    }
+
+    if (findRegions && report.overhangTriangleCount > 0) {
+        std::vector<std::size_t> overhangs;
+        overhangs.reserve(report.overhangTriangleCount);
+        for (std::size_t i = 0; i < facetCount; i++) {
+            if (overhangFlags[i]) {
+                overhangs.push_back(i);
+            }
+        }
+        report.regions = findOverhangRegions(overhangs, Vector3D{dx, dy, dz}, baseHeight);
+    }
+
+    return report;
+}
+
+std::vector<OverhangRegion> OverhangAnalyzer::findOverhangRegions(const std::vector<std::size_t>& overhangs,
+                                                                  const Vector3D& buildDirection, double baseHeight) const {
+    const std::size_t count = overhangs.size();
+
+    // Weld the corners of the overhanging facets into shared vertex IDs by sorting their positions
+    std::vector<std::size_t> corners(count * 3);
+    std::iota(corners.begin(), corners.end(), 0);
+    auto cornerPosition = [&](std::size_t corner) {
+        std::size_t facet = overhangs[corner / 3];
+        int v = static_cast<int>(corner % 3);
+        return std::array<double, 3>{facets.vertexX[v][facet], facets.vertexY[v][facet], facets.vertexZ[v][facet]};
+    };
+    std::sort(corners.begin(), corners.end(),
+              [&](std::size_t a, std::size_t b) { return cornerPosition(a) < cornerPosition(b); });
+
+    std::vector<std::size_t> vertexIds(count * 3);
+    std::size_t nextId = 0;
+    for (std::size_t i = 0; i < corners.size(); i++) {
+        if (i > 0 && cornerPosition(corners[i]) != cornerPosition(corners[i - 1])) {
+            nextId++;
+        }
+        vertexIds[corners[i]] = nextId;
+    }
+
+    // Facets sharing an edge end up next to each other once the edges are sorted
+    struct Edge {
+        std::size_t low, high, facet;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(count * 3);
+    for (std::size_t f = 0; f < count; f++) {
+        for (int v = 0; v < 3; v++) {
+            std::size_t a = vertexIds[f * 3 + v];
+            std::size_t b = vertexIds[f * 3 + (v + 1) % 3];
+            edges.push_back(Edge{std::min(a, b), std::max(a, b), f});
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.low < b.low || (a.low == b.low && a.high < b.high);
+    });
+
+    std::vector<std::size_t> parents(count);
+    std::iota(parents.begin(), parents.end(), 0);
+    for (std::size_t i = 1; i < edges.size(); i++) {
+        if (edges[i].low == edges[i - 1].low && edges[i].high == edges[i - 1].high) {
+            std::size_t a = findRoot(parents, edges[i].facet);
+            std::size_t b = findRoot(parents, edges[i - 1].facet);
+            if (a != b) {
+                parents[a] = b;
+            }
+        }
+    }
+
+    // Measure each region, with its footprint expressed in a basis of the build plane
+    Vector3D helper = std::abs(buildDirection.x) < 0.9 ? Vector3D{1, 0, 0} : Vector3D{0, 1, 0};
+    Vector3D u = crossProduct(buildDirection, helper);
+    u = u * (1.0 / std::sqrt(dotProduct(u, u)));
+    Vector3D v = crossProduct(buildDirection, u);
+
+    std::vector<std::size_t> regionOfRoot(count, count);
+    std::vector<OverhangRegion> regions;
+    for (std::size_t f = 0; f < count; f++) {
+        std::size_t root = findRoot(parents, f);
+        if (regionOfRoot[root] == count) {
+            regionOfRoot[root] = regions.size();
+            OverhangRegion region;
+            region.footprintMin = Point2D{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+            region.footprintMax = Point2D{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+            regions.push_back(region);
+        }
+        OverhangRegion& region = regions[regionOfRoot[root]];
+
+        std::size_t facet = overhangs[f];
+        Vector3D normal{facets.normalX[facet], facets.normalY[facet], facets.normalZ[facet]};
+        double projected = facets.area[facet] * -dotProduct(normal, buildDirection);
+        double centroidHeight = 0.0;
+        for (int k = 0; k < 3; k++) {
+            Vector3D p{facets.vertexX[k][facet], facets.vertexY[k][facet], facets.vertexZ[k][facet]};
+            centroidHeight += dotProduct(p, buildDirection) / 3.0;
+            Point2D footprint{dotProduct(p, u), dotProduct(p, v)};
+            region.footprintMin.x = std::min(region.footprintMin.x, footprint.x);
+            region.footprintMin.y = std::min(region.footprintMin.y, footprint.y);
+            region.footprintMax.x = std::max(region.footprintMax.x, footprint.x);
+            region.footprintMax.y = std::max(region.footprintMax.y, footprint.y);
+        }
+
+        region.triangles.push_back(facet);
+        region.area += facets.area[facet];
+        region.projectedArea += projected;
+        region.supportVolume += projected * (centroidHeight - baseHeight);
+    }
+
+    std::sort(regions.begin(), regions.end(), [](const OverhangRegion& a, const OverhangRegion& b) {
+        return a.projectedArea > b.projectedArea;
+    });
+    return regions;
+}
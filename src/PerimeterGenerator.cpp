@@ -0,0 +1,666 @@
+#include "PerimeterGenerator.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace {
+    const double SCALE = 10000.0; // Integer units per mm
+    const double SAMPLE_OFFSET = 0.25; // How far beside an edge its winding numbers are sampled, in integer units
+    const double MIN_SAMPLE_OFFSET = 1e-4; // Closest the samples are moved in where other edges pass between, in integer units
+    const double ROUNDING_TOLERANCE = 1.0; // How far points that were in line can stray after rounding, in integer units
+    const double CLEARANCE_MARGIN = 10.0; // Rounding allowed for when checking offset points against the source, in integer units
+
+    struct IntPoint {
+        std::int64_t x, y;
+
+        bool operator==(const IntPoint& p) const {
+            return x == p.x && y == p.y;
+        }
+
+        bool operator!=(const IntPoint& p) const {
+            return !(*this == p);
+        }
+
+        bool operator<(const IntPoint& p) const {
+            return x < p.x || (x == p.x && y < p.y);
+        }
+    };
+
+    using Path = std::vector<IntPoint>;
+
+    struct Edge {
+        IntPoint start, end;
+
+        bool operator==(const Edge& e) const {
+            return start == e.start && end == e.end;
+        }
+
+        bool operator<(const Edge& e) const {
+            return start < e.start || (start == e.start && end < e.end);
+        }
+    };
+
+    // Twice the signed area of the triangle o, a, b. Exact for coordinates up to about 300 m
+    std::int64_t cross(const IntPoint& o, const IntPoint& a, const IntPoint& b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    int sign(std::int64_t value) {
+        return (value > 0) - (value < 0);
+    }
+
+    IntPoint roundPoint(double x, double y) {
+        return IntPoint{std::llround(x), std::llround(y)};
+    }
+
+    // Whether p, known to be in line with a and b, lies strictly between them
+    bool strictlyInside(const IntPoint& a, const IntPoint& b, const IntPoint& p) {
+        return p != a && p != b &&
+               std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+               std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+    }
+
+    double pathArea(const Path& path) {
+        double area = 0.0;
+        for (std::size_t i = 0, j = path.size() - 1; i < path.size(); j = i++) {
+            area += static_cast<double>(path[j].x) * path[i].y - static_cast<double>(path[i].x) * path[j].y;
+        }
+        return 0.5 * area;
+    }
+
+    // Drops repeated and collinear points, which give offset edges no direction
+    Path simplifyPath(Path path) {
+        bool changed = true;
+        while (changed && path.size() >= 3) {
+            changed = false;
+            Path simplified;
+            simplified.reserve(path.size());
+            for (std::size_t i = 0; i < path.size(); i++) {
+                const IntPoint& previous = simplified.empty() ? path.back() : simplified.back();
+                const IntPoint& next = path[(i + 1) % path.size()];
+                if (path[i] == previous || cross(previous, path[i], next) == 0) {
+                    changed = true;
+                    continue;
+                }
+                simplified.push_back(path[i]);
+            }
+            path.swap(simplified);
+        }
+        return path.size() >= 3 ? path : Path();
+    }
+
+    // Drops points as long as every dropped point stays within the tolerance of the edge that
+    // replaces it. With shortEdgesOnly, only the points at either end of an edge shorter than the
+    // tolerance are candidates
+    Path dropPoints(const Path& path, double tolerance, bool shortEdgesOnly) {
+        auto withinTolerance = [tolerance](const IntPoint& start, const IntPoint& end, const IntPoint& point) {
+            double spanX = static_cast<double>(end.x - start.x), spanY = static_cast<double>(end.y - start.y);
+            return std::abs(static_cast<double>(cross(start, end, point))) <= tolerance * std::sqrt(spanX * spanX + spanY * spanY);
+        };
+        auto shortEdge = [tolerance](const IntPoint& a, const IntPoint& b) {
+            double dx = static_cast<double>(b.x - a.x), dy = static_cast<double>(b.y - a.y);
+            return dx * dx + dy * dy < tolerance * tolerance;
+        };
+
+        Path simplified{path[0]};
+        std::vector<IntPoint> dropped;
+        for (std::size_t i = 1; i < path.size(); i++) {
+            const IntPoint& next = path[(i + 1) % path.size()];
+            bool drop = !shortEdgesOnly || shortEdge(path[i - 1], path[i]) || shortEdge(path[i], next);
+            for (std::size_t k = 0; drop && k <= dropped.size(); k++) {
+                drop = withinTolerance(simplified.back(), next, k < dropped.size() ? dropped[k] : path[i]);
+            }
+            if (drop) {
+                dropped.push_back(path[i]);
+            } else {
+                simplified.push_back(path[i]);
+                dropped.clear();
+            }
+        }
+        return simplified;
+    }
+
+    Path toPath(const Contour& contour, double tolerance) {
+        Path path;
+        path.reserve(contour.points.size());
+        for (const auto& point : contour.points) {
+            path.push_back(roundPoint(point.x * SCALE, point.y * SCALE));
+        }
+        // Points the slicer left in line come out of rounding slightly bent, and facet edges crossing
+        // the slice plane leave very short edges; both make corners too small to offset cleanly
+        path = simplifyPath(std::move(path));
+        if (!path.empty()) {
+            path = simplifyPath(dropPoints(path, ROUNDING_TOLERANCE, false));
+        }
+        return path.empty() ? path : simplifyPath(dropPoints(path, tolerance, true));
+    }
+
+    /**
+     * Moves every edge of a loop a distance to its left, into the material, joining the
+     * moved edges at each corner. The result may overlap itself.
+     */
+    Path offsetPath(const Path& path, double distance, const PerimeterSettings& settings) {
+        const std::size_t n = path.size();
+        const double arcTolerance = std::min(settings.arcTolerance * SCALE, 0.5 * distance);
+        const double arcStep = 2.0 * std::acos(1.0 - arcTolerance / distance);
+
+        // Unit direction and length of each edge, from point i to point i + 1
+        std::vector<double> directionX(n), directionY(n), lengths(n);
+        for (std::size_t i = 0; i < n; i++) {
+            double dx = static_cast<double>(path[(i + 1) % n].x - path[i].x);
+            double dy = static_cast<double>(path[(i + 1) % n].y - path[i].y);
+            lengths[i] = std::sqrt(dx * dx + dy * dy);
+            directionX[i] = dx / lengths[i];
+            directionY[i] = dy / lengths[i];
+        }
+
+        // How far a sharp corner at each left turn cuts back along both of its edges. An edge
+        // cut back by more than its length would reverse, and reflect through the feature
+        std::vector<double> cutBack(n, 0.0);
+        for (std::size_t i = 0; i < n; i++) {
+            const std::size_t previous = (i + n - 1) % n;
+            const double turn = directionX[previous] * directionY[i] - directionY[previous] * directionX[i];
+            const double dot = directionX[previous] * directionX[i] + directionY[previous] * directionY[i];
+            if (turn >= 0.0) {
+                cutBack[i] = 1.0 + dot > 1e-9 ? distance * turn / (1.0 + dot) : INFINITY;
+            }
+        }
+
+        Path offset;
+        offset.reserve(n * 2);
+        for (std::size_t i = 0; i < n; i++) {
+            const std::size_t previous = (i + n - 1) % n;
+            const double px = static_cast<double>(path[i].x);
+            const double py = static_cast<double>(path[i].y);
+            // Left normals of the incoming and outgoing edges
+            const double n1x = -directionY[previous], n1y = directionX[previous];
+            const double n2x = -directionY[i], n2y = directionX[i];
+            const double turn = directionX[previous] * directionY[i] - directionY[previous] * directionX[i];
+            const double dot = directionX[previous] * directionX[i] + directionY[previous] * directionY[i];
+
+            // Left turns point out of the material, so the moved edges cross at a sharp corner.
+            // Next to an edge that would reverse, the ends are linked straight across instead;
+            // what the link adds lies within the distance of the corner and is cleared away
+            if (turn >= 0.0) {
+                const std::size_t next = (i + 1) % n;
+                if (cutBack[previous] + cutBack[i] <= lengths[previous] && cutBack[i] + cutBack[next] <= lengths[i]) {
+                    double miter = distance / (1.0 + dot);
+                    offset.push_back(roundPoint(px + (n1x + n2x) * miter, py + (n1y + n2y) * miter));
+                    continue;
+                }
+                offset.push_back(roundPoint(px + n1x * distance, py + n1y * distance));
+                offset.push_back(roundPoint(px + n2x * distance, py + n2y * distance));
+                continue;
+            }
+
+            // Right turns point into the material, and the gap between the moved edges needs a join
+            if (settings.joinType == JoinType::Miter && 1.0 + dot > 1e-9 && std::sqrt(2.0 / (1.0 + dot)) <= settings.miterLimit) {
+                double miter = distance / (1.0 + dot);
+                offset.push_back(roundPoint(px + (n1x + n2x) * miter, py + (n1y + n2y) * miter));
+                continue;
+            }
+
+            if (settings.joinType == JoinType::Miter) {
+                // Square the miter off across its bisector at the limit, rather than bevelling it,
+                // so no part of the join comes closer to the corner than the offset distance
+                double bisectorX = n1x + n2x, bisectorY = n1y + n2y;
+                double length = std::sqrt(bisectorX * bisectorX + bisectorY * bisectorY);
+                if (length > 1e-9) {
+                    bisectorX /= length;
+                    bisectorY /= length;
+                } else {
+                    bisectorX = directionX[previous];
+                    bisectorY = directionY[previous];
+                }
+                double reach = std::max(1.0, settings.miterLimit) * distance;
+                double along1 = (reach - distance * (n1x * bisectorX + n1y * bisectorY)) /
+                                (directionX[previous] * bisectorX + directionY[previous] * bisectorY);
+                double along2 = (reach - distance * (n2x * bisectorX + n2y * bisectorY)) /
+                                -(directionX[i] * bisectorX + directionY[i] * bisectorY);
+                offset.push_back(roundPoint(px + n1x * distance + directionX[previous] * along1,
+                                            py + n1y * distance + directionY[previous] * along1));
+                offset.push_back(roundPoint(px + n2x * distance - directionX[i] * along2,
+                                            py + n2y * distance - directionY[i] * along2));
+                continue;
+            }
+
+            // Round joins sweep clockwise from the incoming normal to the outgoing one
+            double sweep = std::atan2(turn, dot);
+            int steps = static_cast<int>(std::ceil(std::abs(sweep) / arcStep));
+            double start = std::atan2(n1y, n1x);
+            offset.push_back(roundPoint(px + n1x * distance, py + n1y * distance));
+            for (int step = 1; step < steps; step++) {
+                double angle = start + sweep * step / steps;
+                offset.push_back(roundPoint(px + std::cos(angle) * distance, py + std::sin(angle) * distance));
+            }
+            offset.push_back(roundPoint(px + n2x * distance, py + n2y * distance));
+        }
+        return offset;
+    }
+
+    /**
+     * Finds the points where edges cross or touch each other's interiors, using a uniform grid
+     * so only edges in the same cell are compared. Returns the split points of each edge.
+     */
+    std::vector<std::vector<IntPoint>> findSplitPoints(const std::vector<Edge>& edges, const IntPoint& minBound, const IntPoint& maxBound) {
+        const std::int64_t gridSize = std::max<std::int64_t>(1, static_cast<std::int64_t>(std::sqrt(static_cast<double>(edges.size()))));
+        const std::int64_t cellWidth = (maxBound.x - minBound.x) / gridSize + 1;
+        const std::int64_t cellHeight = (maxBound.y - minBound.y) / gridSize + 1;
+
+        std::vector<std::pair<std::int64_t, std::uint32_t>> cellEdges;
+        cellEdges.reserve(edges.size() * 2);
+        for (std::size_t e = 0; e < edges.size(); e++) {
+            const Edge& edge = edges[e];
+            std::int64_t x0 = (std::min(edge.start.x, edge.end.x) - minBound.x) / cellWidth;
+            std::int64_t x1 = (std::max(edge.start.x, edge.end.x) - minBound.x) / cellWidth;
+            std::int64_t y0 = (std::min(edge.start.y, edge.end.y) - minBound.y) / cellHeight;
+            std::int64_t y1 = (std::max(edge.start.y, edge.end.y) - minBound.y) / cellHeight;
+            for (std::int64_t y = y0; y <= y1; y++) {
+                for (std::int64_t x = x0; x <= x1; x++) {
+                    cellEdges.emplace_back(y * gridSize + x, static_cast<std::uint32_t>(e));
+                }
+            }
+        }
+        std::sort(cellEdges.begin(), cellEdges.end());
+
+        std::vector<std::vector<IntPoint>> splits(edges.size());
+        for (std::size_t begin = 0, end = 0; begin < cellEdges.size(); begin = end) {
+            while (end < cellEdges.size() && cellEdges[end].first == cellEdges[begin].first) {
+                end++;
+            }
+
+            for (std::size_t i = begin; i < end; i++) {
+                const Edge& a = edges[cellEdges[i].second];
+                for (std::size_t j = i + 1; j < end; j++) {
+                    const Edge& b = edges[cellEdges[j].second];
+                    std::int64_t o1 = cross(a.start, a.end, b.start);
+                    std::int64_t o2 = cross(a.start, a.end, b.end);
+                    std::int64_t o3 = cross(b.start, b.end, a.start);
+                    std::int64_t o4 = cross(b.start, b.end, a.end);
+
+                    if (sign(o1) * sign(o2) < 0 && sign(o3) * sign(o4) < 0) {
+                        double t = static_cast<double>(o1) / (static_cast<double>(o1) - static_cast<double>(o2));
+                        IntPoint crossing = roundPoint(b.start.x + t * (b.end.x - b.start.x), b.start.y + t * (b.end.y - b.start.y));
+                        splits[cellEdges[i].second].push_back(crossing);
+                        splits[cellEdges[j].second].push_back(crossing);
+                        continue;
+                    }
+
+                    // An endpoint resting on the other edge, which also covers overlapping collinear edges
+                    if (o1 == 0 && strictlyInside(a.start, a.end, b.start)) splits[cellEdges[i].second].push_back(b.start);
+                    if (o2 == 0 && strictlyInside(a.start, a.end, b.end)) splits[cellEdges[i].second].push_back(b.end);
+                    if (o3 == 0 && strictlyInside(b.start, b.end, a.start)) splits[cellEdges[j].second].push_back(a.start);
+                    if (o4 == 0 && strictlyInside(b.start, b.end, a.end)) splits[cellEdges[j].second].push_back(a.end);
+                }
+            }
+        }
+        return splits;
+    }
+
+    /**
+     * Winding numbers of points against a set of edges that only meet at their ends. Edges are
+     * bucketed into horizontal bands, so a query only visits the edges near its height.
+     */
+    class WindingIndex {
+    public:
+        WindingIndex(const std::vector<Edge>& edges, std::int64_t minY, std::int64_t maxY)
+            : edges(edges), minY(minY) {
+            bandCount = std::max<std::int64_t>(1, static_cast<std::int64_t>(std::sqrt(static_cast<double>(edges.size()))));
+            bandHeight = (maxY - minY) / bandCount + 1;
+
+            bandStart.assign(bandCount + 1, 0);
+            for (const auto& edge : edges) {
+                for (std::int64_t band = bandOf(std::min(edge.start.y, edge.end.y)); band <= bandOf(std::max(edge.start.y, edge.end.y)); band++) {
+                    bandStart[band + 1]++;
+                }
+            }
+            for (std::int64_t band = 0; band < bandCount; band++) {
+                bandStart[band + 1] += bandStart[band];
+            }
+            bandEdges.resize(bandStart[bandCount]);
+            std::vector<std::size_t> fill(bandStart.begin(), bandStart.end() - 1);
+            for (std::size_t e = 0; e < edges.size(); e++) {
+                const Edge& edge = edges[e];
+                for (std::int64_t band = bandOf(std::min(edge.start.y, edge.end.y)); band <= bandOf(std::max(edge.start.y, edge.end.y)); band++) {
+                    bandEdges[fill[band]++] = static_cast<std::uint32_t>(e);
+                }
+            }
+        }
+
+        // Counts signed crossings of a ray from the point towards +x, so counter-clockwise loops add one
+        int winding(double x, double y) const {
+            std::int64_t band = std::clamp<std::int64_t>(static_cast<std::int64_t>(std::floor((y - minY) / bandHeight)), 0, bandCount - 1);
+            int winding = 0;
+            for (std::size_t i = bandStart[band]; i < bandStart[band + 1]; i++) {
+                const Edge& edge = edges[bandEdges[i]];
+                double ax = static_cast<double>(edge.start.x), ay = static_cast<double>(edge.start.y);
+                double bx = static_cast<double>(edge.end.x), by = static_cast<double>(edge.end.y);
+                double side = (bx - ax) * (y - ay) - (x - ax) * (by - ay);
+                if (ay <= y) {
+                    if (by > y && side > 0) {
+                        winding++;
+                    }
+                } else if (by <= y && side < 0) {
+                    winding--;
+                }
+            }
+            return winding;
+        }
+
+        // Tells whether an edge passes strictly between two points; edges touching the segment do not count
+        bool separates(double x0, double y0, double x1, double y1) const {
+            auto side = [](double ax, double ay, double bx, double by, double px, double py) {
+                double value = (bx - ax) * (py - ay) - (px - ax) * (by - ay);
+                return (value > 0.0) - (value < 0.0);
+            };
+            std::int64_t first = std::clamp<std::int64_t>(static_cast<std::int64_t>(std::floor((std::min(y0, y1) - minY) / bandHeight)), 0, bandCount - 1);
+            std::int64_t last = std::clamp<std::int64_t>(static_cast<std::int64_t>(std::floor((std::max(y0, y1) - minY) / bandHeight)), 0, bandCount - 1);
+            for (std::int64_t band = first; band <= last; band++) {
+                for (std::size_t i = bandStart[band]; i < bandStart[band + 1]; i++) {
+                    const Edge& edge = edges[bandEdges[i]];
+                    double ax = static_cast<double>(edge.start.x), ay = static_cast<double>(edge.start.y);
+                    double bx = static_cast<double>(edge.end.x), by = static_cast<double>(edge.end.y);
+                    if (side(ax, ay, bx, by, x0, y0) * side(ax, ay, bx, by, x1, y1) < 0 &&
+                        side(x0, y0, x1, y1, ax, ay) * side(x0, y0, x1, y1, bx, by) < 0) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        const std::vector<Edge>& edges;
+        std::int64_t minY;
+        std::int64_t bandCount;
+        std::int64_t bandHeight;
+        std::vector<std::size_t> bandStart;
+        std::vector<std::uint32_t> bandEdges;
+
+        std::int64_t bandOf(std::int64_t y) const {
+            return std::clamp<std::int64_t>((y - minY) / bandHeight, 0, bandCount - 1);
+        }
+    };
+
+    /**
+     * Tells whether points come closer than a clearance to the loops an offset was made from,
+     * edges and corners included. Every point of a true offset keeps its distance; a feature
+     * that collapsed under the offset turns inside out, and the loops it leaves behind do not.
+     * Edges are bucketed on a sparse grid of cells one clearance wide.
+     */
+    class ClearanceIndex {
+    public:
+        ClearanceIndex(const std::vector<Path>& loops, double clearance)
+            : clearance(clearance), cellSize(std::max<std::int64_t>(1, static_cast<std::int64_t>(clearance))) {
+            for (const auto& loop : loops) {
+                const std::size_t n = loop.size();
+                for (std::size_t i = 0; i < n; i++) {
+                    const IntPoint& start = loop[i];
+                    const IntPoint& end = loop[(i + 1) % n];
+                    const std::uint32_t index = static_cast<std::uint32_t>(segments.size());
+                    segments.push_back(Edge{start, end});
+
+                    // Register the edge in chunks no longer than a cell, so it only lands in the cells it passes through
+                    double dx = static_cast<double>(end.x - start.x);
+                    double dy = static_cast<double>(end.y - start.y);
+                    int chunks = std::max(1, static_cast<int>(std::ceil(std::sqrt(dx * dx + dy * dy) / cellSize)));
+                    for (int chunk = 0; chunk < chunks; chunk++) {
+                        IntPoint a = roundPoint(start.x + dx * chunk / chunks, start.y + dy * chunk / chunks);
+                        IntPoint b = roundPoint(start.x + dx * (chunk + 1) / chunks, start.y + dy * (chunk + 1) / chunks);
+                        for (std::int64_t y = cellOf(std::min(a.y, b.y)); y <= cellOf(std::max(a.y, b.y)); y++) {
+                            for (std::int64_t x = cellOf(std::min(a.x, b.x)); x <= cellOf(std::max(a.x, b.x)); x++) {
+                                cells.push_back({{x, y}, index});
+                            }
+                        }
+                    }
+                }
+            }
+            std::sort(cells.begin(), cells.end());
+            cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+        }
+
+        bool tooClose(double x, double y) const {
+            if (clearance <= 0.0) {
+                return false;
+            }
+            const std::int64_t cellX = static_cast<std::int64_t>(std::floor(x / cellSize));
+            const std::int64_t cellY = static_cast<std::int64_t>(std::floor(y / cellSize));
+            const double limit = clearance * clearance;
+            for (std::int64_t y0 = cellY - 1; y0 <= cellY + 1; y0++) {
+                for (std::int64_t x0 = cellX - 1; x0 <= cellX + 1; x0++) {
+                    auto entry = std::lower_bound(cells.begin(), cells.end(), Cell{{x0, y0}, 0});
+                    for (; entry != cells.end() && entry->first == std::make_pair(x0, y0); ++entry) {
+                        const Edge& segment = segments[entry->second];
+                        double ax = static_cast<double>(segment.start.x), ay = static_cast<double>(segment.start.y);
+                        double dx = static_cast<double>(segment.end.x) - ax, dy = static_cast<double>(segment.end.y) - ay;
+                        double lengthSquared = dx * dx + dy * dy;
+                        double along = lengthSquared > 0.0 ? std::clamp(((x - ax) * dx + (y - ay) * dy) / lengthSquared, 0.0, 1.0) : 0.0;
+                        double offX = ax + dx * along - x, offY = ay + dy * along - y;
+                        if (offX * offX + offY * offY < limit) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        using Cell = std::pair<std::pair<std::int64_t, std::int64_t>, std::uint32_t>;
+
+        std::int64_t cellOf(std::int64_t coordinate) const {
+            return coordinate >= 0 ? coordinate / cellSize : -((-coordinate + cellSize - 1) / cellSize);
+        }
+
+        double clearance;
+        std::int64_t cellSize;
+        std::vector<Edge> segments;
+        std::vector<Cell> cells;
+    };
+
+    /**
+     * Resolves a set of overlapping loops into the boundary of the area they wind around
+     * positively, with material on the left of every returned loop. Area closer than the
+     * clearance to the source loops is not counted, which drops what is left of features
+     * that collapsed under the offset.
+     */
+    std::vector<Path> cleanLoops(const std::vector<Path>& loops, const std::vector<Path>& sources, double clearance, double minimumArea) {
+        std::vector<Edge> edges;
+        IntPoint minBound{INT64_MAX, INT64_MAX};
+        IntPoint maxBound{INT64_MIN, INT64_MIN};
+        for (const auto& loop : loops) {
+            for (std::size_t i = 0; i < loop.size(); i++) {
+                const IntPoint& next = loop[(i + 1) % loop.size()];
+                if (loop[i] != next) {
+                    edges.push_back(Edge{loop[i], next});
+                }
+                minBound = IntPoint{std::min(minBound.x, loop[i].x), std::min(minBound.y, loop[i].y)};
+                maxBound = IntPoint{std::max(maxBound.x, loop[i].x), std::max(maxBound.y, loop[i].y)};
+            }
+        }
+        if (edges.empty()) {
+            return {};
+        }
+
+        // Split the edges wherever they meet, so the pieces only touch at their ends
+        std::vector<std::vector<IntPoint>> splits = findSplitPoints(edges, minBound, maxBound);
+        std::vector<Edge> pieces;
+        pieces.reserve(edges.size());
+        for (std::size_t e = 0; e < edges.size(); e++) {
+            const Edge& edge = edges[e];
+            std::vector<IntPoint>& points = splits[e];
+            points.push_back(edge.start);
+            points.push_back(edge.end);
+            const std::int64_t dx = edge.end.x - edge.start.x;
+            const std::int64_t dy = edge.end.y - edge.start.y;
+            auto along = [&](const IntPoint& p) { return (p.x - edge.start.x) * dx + (p.y - edge.start.y) * dy; };
+            std::sort(points.begin(), points.end(), [&](const IntPoint& a, const IntPoint& b) { return along(a) < along(b); });
+            points.erase(std::unique(points.begin(), points.end()), points.end());
+            for (std::size_t i = 0; i + 1 < points.size(); i++) {
+                pieces.push_back(Edge{points[i], points[i + 1]});
+            }
+        }
+
+        // Keep the pieces with material on one side only, turned so the material is on their left
+        WindingIndex index(pieces, minBound.y, maxBound.y);
+        ClearanceIndex sourceIndex(sources, clearance);
+        auto filled = [&](double x, double y) {
+            return index.winding(x, y) > 0 && !sourceIndex.tooClose(x, y);
+        };
+        std::vector<Edge> boundary;
+        for (const auto& piece : pieces) {
+            double dx = static_cast<double>(piece.end.x - piece.start.x);
+            double dy = static_cast<double>(piece.end.y - piece.start.y);
+            double length = std::sqrt(dx * dx + dy * dy);
+            double midX = 0.5 * (piece.start.x + piece.end.x);
+            double midY = 0.5 * (piece.start.y + piece.end.y);
+
+            // Pieces can meet at very sharp angles; move the samples in until no other piece passes
+            // between them and this one, or they would read the winding of the wrong region
+            double step = SAMPLE_OFFSET;
+            while (step > MIN_SAMPLE_OFFSET && (index.separates(midX, midY, midX - dy / length * step, midY + dx / length * step) ||
+                                                index.separates(midX, midY, midX + dy / length * step, midY - dx / length * step))) {
+                step *= 0.5;
+            }
+            double nx = -dy / length * step, ny = dx / length * step;
+
+            bool filledLeft = filled(midX + nx, midY + ny);
+            bool filledRight = filled(midX - nx, midY - ny);
+            if (filledLeft && !filledRight) {
+                boundary.push_back(piece);
+            } else if (filledRight && !filledLeft) {
+                boundary.push_back(Edge{piece.end, piece.start});
+            }
+        }
+        std::sort(boundary.begin(), boundary.end());
+        boundary.erase(std::unique(boundary.begin(), boundary.end()), boundary.end());
+
+        // Rounding around very short edges can leave spurs that nothing continues from or leads
+        // into; trim them, or stitching could follow one and lose the loop it hangs off
+        std::map<IntPoint, std::size_t> outgoing, incoming;
+        for (const auto& piece : boundary) {
+            outgoing[piece.start]++;
+            incoming[piece.end]++;
+        }
+        std::vector<bool> spur(boundary.size(), false);
+        for (bool trimmed = true; trimmed;) {
+            trimmed = false;
+            for (std::size_t i = 0; i < boundary.size(); i++) {
+                if (!spur[i] && (outgoing[boundary[i].end] == 0 || incoming[boundary[i].start] == 0)) {
+                    spur[i] = true;
+                    outgoing[boundary[i].start]--;
+                    incoming[boundary[i].end]--;
+                    trimmed = true;
+                }
+            }
+        }
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < boundary.size(); i++) {
+            if (!spur[i]) {
+                boundary[kept++] = boundary[i];
+            }
+        }
+        boundary.resize(kept);
+
+        // Stitch the boundary pieces into loops by following matching endpoints
+        std::vector<bool> used(boundary.size(), false);
+        std::vector<Path> result;
+        for (std::size_t first = 0; first < boundary.size(); first++) {
+            if (used[first]) {
+                continue;
+            }
+            used[first] = true;
+            Path path{boundary[first].start};
+            IntPoint current = boundary[first].end;
+            bool closed = false;
+            while (true) {
+                if (current == path.front()) {
+                    closed = true;
+                    break;
+                }
+                path.push_back(current);
+                auto next = std::lower_bound(boundary.begin(), boundary.end(), Edge{current, IntPoint{INT64_MIN, INT64_MIN}});
+                while (next != boundary.end() && next->start == current && used[next - boundary.begin()]) {
+                    ++next;
+                }
+                if (next == boundary.end() || next->start != current) {
+                    break;
+                }
+                used[next - boundary.begin()] = true;
+                current = next->end;
+            }
+
+            if (closed) {
+                path = simplifyPath(std::move(path));
+                if (!path.empty() && std::abs(pathArea(path)) >= minimumArea) {
+                    result.push_back(std::move(path));
+                }
+            }
+        }
+        return result;
+    }
+}
+
+PerimeterGenerator::PerimeterGenerator(const PerimeterSettings& settings)
+    : settings(settings), threadCount(0) {}
+
+void PerimeterGenerator::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+std::vector<Contour> PerimeterGenerator::offsetContours(const std::vector<Contour>& contours, double distance) const {
+    std::vector<Path> sources;
+    std::vector<Path> raw;
+    for (const auto& contour : contours) {
+        if (!contour.closed) {
+            continue;
+        }
+        Path path = toPath(contour, settings.arcTolerance * SCALE);
+        if (!path.empty()) {
+            raw.push_back(offsetPath(path, distance * SCALE, settings));
+            sources.push_back(std::move(path));
+        }
+    }
+
+    // Slivers much narrower than a line cannot be printed, and are mostly rounding debris
+    double sliver = 0.1 * settings.lineWidth * SCALE;
+    // Round joins follow chords of their arcs, which cut up to the arc tolerance inside them
+    double clearance = distance * SCALE - CLEARANCE_MARGIN;
+    if (settings.joinType == JoinType::Round) {
+        clearance -= std::min(settings.arcTolerance * SCALE, 0.5 * distance * SCALE);
+    }
+    std::vector<Path> loops = cleanLoops(raw, sources, clearance, sliver * sliver);
+
+    std::vector<Contour> offset;
+    offset.reserve(loops.size());
+    for (const auto& loop : loops) {
+        Contour contour;
+        contour.closed = true;
+        contour.points.reserve(loop.size());
+        for (const auto& point : loop) {
+            contour.points.push_back(Point2D{point.x / SCALE, point.y / SCALE});
+        }
+        offset.push_back(std::move(contour));
+    }
+    return offset;
+}
+
+void PerimeterGenerator::generateLayer(Layer& layer) const {
+    layer.perimeters.clear();
+    for (std::size_t k = 0; k < settings.count; k++) {
+        std::vector<Contour> loops = offsetContours(layer.contours, (k + 0.5) * settings.lineWidth);
+        if (loops.empty()) {
+            break;  // Every further perimeter lies inside this one, so is empty too
+        }
+        layer.perimeters.push_back(std::move(loops));
+    }
+}
+
+void PerimeterGenerator::generateLayers(std::vector<Layer>& layers) const {
+    parallelFor(layers.size(), threadCount, [&](std::size_t i) {
+        generateLayer(layers[i]);
+    });
+}
@@ -0,0 +1,130 @@
+#include "Plate.h"
+#include "Contours.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+Plate::Plate(double layerHeight)
+    : layerHeight(layerHeight), threadCount(0), perimeterGenerator(nullptr) {}
+
+void Plate::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+void Plate::setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator) {
+    this->perimeterGenerator = perimeterGenerator;
+}
+
+std::size_t Plate::addMesh(const STLReader& stlReader) {
+    meshes.push_back(Mesh{&stlReader, std::make_unique<Slicer>(stlReader, layerHeight, threadCount)});
+    return meshes.size() - 1;
+}
+
+bool Plate::addInstance(std::size_t meshIndex, const Placement& placement) {
+    if (meshIndex >= meshes.size()) {
+        return false;
+    }
+
+    double radians = placement.rotationZ * M_PI / 180.0;
+    instances.push_back(Instance{meshIndex, placement, std::cos(radians), std::sin(radians)});
+    return true;
+}
+
+void Plate::sliceModel() {
+    layers.clear();
+
+    if (instances.empty()) {
+        return;
+    }
+
+    // Instances of the same mesh at the same Z-offset cut the mesh at the same local heights,
+    // so they can share one cursor and one set of slice lines per layer.
+    std::map<std::pair<std::size_t, double>, std::vector<std::size_t>> groupMap;
+    double plateHeight = 0.0;
+    for (std::size_t i = 0; i < instances.size(); i++) {
+        const Instance& instance = instances[i];
+        groupMap[{instance.meshIndex, instance.placement.translation.z}].push_back(i);
+
+        double top = meshes[instance.meshIndex].stlReader->getMaximumBoundingBox().z + instance.placement.translation.z;
+        plateHeight = std::max(plateHeight, top);
+    }
+
+    struct Group {
+        std::size_t meshIndex;
+        double zOffset;
+        std::vector<std::size_t> instanceIndices;
+        std::size_t triangleIndex;
+    };
+
+    std::vector<Group> groups;
+    groups.reserve(groupMap.size());
+    for (auto& entry : groupMap) {
+        groups.push_back(Group{entry.first.first, entry.first.second, std::move(entry.second), 0});
+    }
+
+    int numLayers = ceil(plateHeight / layerHeight);
+    layers.reserve(numLayers);
+
+    for (int i = 0; i < numLayers; i++) {
+        double layerZ = i * layerHeight;
+        Layer currentLayer;
+        currentLayer.height = layerZ;
+
+        for (auto& group : groups) {
+            Layer meshLayer;
+            meshes[group.meshIndex].slicer->sliceLayer(layerZ - group.zOffset, group.triangleIndex, meshLayer);
+
+            if (meshLayer.lines.empty() && meshLayer.projectedLines.empty()) {
+                continue;
+            }
+
+            // Stitch and measure once per group; a Z-rotation and translation keeps both the
+            // contour orientation and the measurements of every copy
+            buildLayerContours(meshLayer);
+
+            for (std::size_t instanceIndex : group.instanceIndices) {
+                const Instance& instance = instances[instanceIndex];
+                for (const auto& line : meshLayer.lines) {
+                    currentLayer.lines.push_back({placePoint(line.start, instance), placePoint(line.end, instance)});
+                }
+                for (const auto& line : meshLayer.projectedLines) {
+                    currentLayer.projectedLines.push_back({placePoint(line.start, instance), placePoint(line.end, instance)});
+                }
+                for (const auto& contour : meshLayer.contours) {
+                    Contour placed{std::vector<Point2D>(), contour.closed};
+                    placed.points.reserve(contour.points.size());
+                    for (const auto& point : contour.points) {
+                        placed.points.push_back(placePoint(point, instance));
+                    }
+                    currentLayer.contours.push_back(std::move(placed));
+                }
+                currentLayer.stats.area += meshLayer.stats.area;
+                currentLayer.stats.perimeter += meshLayer.stats.perimeter;
+                currentLayer.stats.islandCount += meshLayer.stats.islandCount;
+            }
+        }
+
+        layers.push_back(std::move(currentLayer));
+    }
+
+    // Placed copies can overlap, so perimeters come from the merged layer rather than per group
+    if (perimeterGenerator) {
+        perimeterGenerator->generateLayers(layers);
+    }
+}
+
+const std::vector<Layer>& Plate::getLayers() const {
+    return layers;
+}
+
+std::size_t Plate::getInstanceCount() const {
+    return instances.size();
+}
+
+Point2D Plate::placePoint(const Point2D& point, const Instance& instance) const {
+    return Point2D{
+        point.x * instance.cosRotation - point.y * instance.sinRotation + instance.placement.translation.x,
+        point.x * instance.sinRotation + point.y * instance.cosRotation + instance.placement.translation.y
+    };
+}
@@ -1,8 +1,12 @@
 #include "Geometry.h"
 #include "STLReader.h"
+#include "CompressedInput.h"
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
 #include <iostream> 
+#include <limits>
+#include <memory>
 #include <vector>
 
 STLReader::STLReader() 
@@ -30,7 +34,7 @@ bool STLReader::parseVertex(const std::string& line, Point3D& vertex) {
                 &vertex.x, &vertex.y, &vertex.z) == 3;
 }
 
-bool STLReader::readTriangle(std::ifstream& file, Triangle& triangle) {
+bool STLReader::readTriangle(std::istream& file, Triangle& triangle) {
     std::string line; 
 
     if (!std::getline(file, line) || line.find("facet normal") == std::string::npos) {
@@ -144,6 +148,19 @@ void STLReader::updateBoundingBox(const Triangle& triangle) {
         }
 }
 
+void STLReader::recalculateBoundingBox() {
+    minBound = Point3D{std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::max()};
+    maxBound = Point3D{std::numeric_limits<double>::lowest(),
+                       std::numeric_limits<double>::lowest(),
+                       std::numeric_limits<double>::lowest()};
+
+    for (const auto& triangle : triangles) {
+        updateBoundingBox(triangle);
+    }
+}
+
 void STLReader::translateVertex(Point3D& vertex, Vector3D translation) {
     vertex = vertex + translation;
 }
@@ -168,11 +185,22 @@ Point3D STLReader::calculateCentroid() {
 
 
 bool STLReader::readSTL(const std::string& filename){
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    if (!streamSTL(filename, [this](const Triangle& triangle) { triangles.push_back(triangle); })) {
+        return false;
+    }
+
+    volume = calculateVolume();
+    
+    return !triangles.empty();
+}
+
+bool STLReader::streamSTL(const std::string& filename, const std::function<void(const Triangle&)>& onTriangle) {
+    std::unique_ptr<std::istream> input = openInputStream(filename);
+    if (!input) {
         std::cerr << "Failed to open file" << std::endl;
         return false;
     }
+    std::istream& file = *input;
 
     totalSurfaceArea = 0.0;
 
@@ -181,15 +209,64 @@ bool STLReader::readSTL(const std::string& filename){
 
     Triangle triangle;
     while (readTriangle(file, triangle)) {
-        triangles.push_back(triangle);
         updateBoundingBox(triangle);
+        onTriangle(triangle);
     }
 
-    file.close();
+    // Read on to the end, so damage after the last facet (such as a missing gzip trailer) is still seen
+    file.clear(file.rdstate() & std::ios::badbit);
+    file.ignore(std::numeric_limits<std::streamsize>::max());
 
-    volume = calculateVolume();
-    
-    return !triangles.empty();
+    if (file.bad()) {
+        std::cerr << "Failed to read " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool STLReader::scanFacetMinZ(const std::string& filename, const std::function<void(double)>& onFacet, double& maxZ) const {
+    std::unique_ptr<std::istream> input = openInputStream(filename);
+    if (!input) {
+        std::cerr << "Failed to open file" << std::endl;
+        return false;
+    }
+    std::istream& file = *input;
+
+    maxZ = std::numeric_limits<double>::lowest();
+
+    std::string line;
+    std::size_t facetCount = 0;
+    double facetMin = std::numeric_limits<double>::max();
+    int vertexCount = 0;
+    while (std::getline(file, line)) {
+        std::size_t pos = line.find("vertex");
+        if (pos == std::string::npos) {
+            continue;
+        }
+
+        // Skip the keyword and the X and Y tokens, only Z is converted
+        const char* cursor = line.c_str() + pos + 6;
+        for (int token = 0; token < 2; ++token) {
+            while (*cursor == ' ' || *cursor == '\t') ++cursor;
+            while (*cursor && *cursor != ' ' && *cursor != '\t') ++cursor;
+        }
+        double z = std::strtod(cursor, nullptr);
+
+        facetMin = std::min(facetMin, z);
+        maxZ = std::max(maxZ, z);
+        if (++vertexCount == 3) {
+            onFacet(facetMin);
+            facetCount++;
+            facetMin = std::numeric_limits<double>::max();
+            vertexCount = 0;
+        }
+    }
+
+    if (file.bad()) {
+        std::cerr << "Failed to read " << filename << std::endl;
+        return false;
+    }
+    return facetCount > 0;
 }
 
 void STLReader::updateModelStats() {
@@ -208,6 +285,20 @@ const std::vector<Triangle>& STLReader::getTriangles() const {
     return triangles;
 }
 
+void STLReader::setTriangles(std::vector<Triangle> newTriangles) {
+    triangles = std::move(newTriangles);
+
+    recalculateBoundingBox();
+
+    totalSurfaceArea = 0.0;
+    for (const auto& triangle : triangles) {
+        totalSurfaceArea += calculateTriangleArea(calculateTriangleCrossProduct(triangle));
+    }
+
+    volumeCalculated = false;
+    volume = calculateVolume();
+}
+
 double STLReader::calculateVolume() {
     if (!volumeCalculated) {
         volume = 0.0;
@@ -283,4 +374,40 @@ void STLReader::scaleModel(double scaleFactor) {
     // Update bounding box
     minBound = centroid + ((minBound - centroid) * scaleFactor);
     maxBound = centroid + ((maxBound - centroid) * scaleFactor);
-}
\ No newline at end of file
+}
+
+void STLReader::rotateModel(Vector3D axis, double angleDegrees) {
+    double axisLength = sqrt(axis.x*axis.x + axis.y*axis.y + axis.z*axis.z);
+    if (axisLength == 0 || angleDegrees == 0) {
+        return;  // No rotation needed
+    }
+    axis = axis * (1.0 / axisLength);
+
+    // Rodrigues' rotation formula, written out as a matrix
+    double angle = angleDegrees * M_PI / 180.0;
+    double c = cos(angle);
+    double s = sin(angle);
+    double t = 1 - c;
+    double m[3][3] = {
+        {t*axis.x*axis.x + c,        t*axis.x*axis.y - s*axis.z, t*axis.x*axis.z + s*axis.y},
+        {t*axis.x*axis.y + s*axis.z, t*axis.y*axis.y + c,        t*axis.y*axis.z - s*axis.x},
+        {t*axis.x*axis.z - s*axis.y, t*axis.y*axis.z + s*axis.x, t*axis.z*axis.z + c}
+    };
+    auto rotate = [&m](double x, double y, double z) {
+        return Vector3D{m[0][0]*x + m[0][1]*y + m[0][2]*z,
+                        m[1][0]*x + m[1][1]*y + m[1][2]*z,
+                        m[2][0]*x + m[2][1]*y + m[2][2]*z};
+    };
+
+    Point3D centroid = calculateCentroid();
+
+    for (auto& triangle : triangles) {
+        triangle.normal = rotate(triangle.normal.x, triangle.normal.y, triangle.normal.z);
+        for (auto& vertex : triangle.vertices) {
+            vertex = centroid + rotate(vertex.x - centroid.x, vertex.y - centroid.y, vertex.z - centroid.z);
+        }
+    }
+
+    // Surface area and volume are unchanged, only the bounding box moves
+    recalculateBoundingBox();
+}
@@ -0,0 +1,211 @@
+#include "SlicePipeline.h"
+#include "BoundedQueue.h"
+#include "Contours.h"
+#include "Parallel.h"
+#include "Slicer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+    const std::size_t TRIANGLE_BATCH_SIZE = 4096; // Triangles sent per message from the load stage
+}
+
+SlicePipeline::SlicePipeline(double layerHeight, std::size_t queueCapacity)
+    : layerHeight(layerHeight), queueCapacity(queueCapacity), threadCount(0), perimeterGenerator(nullptr), triangleCount(0) {}
+
+void SlicePipeline::setThreadCount(std::size_t threadCount) {
+    this->threadCount = threadCount;
+}
+
+void SlicePipeline::setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator) {
+    this->perimeterGenerator = perimeterGenerator;
+}
+
+void SlicePipeline::setZHeight(double desiredZHeight) {
+    zHeight = desiredZHeight;
+}
+
+const STLReader& SlicePipeline::getReader() const {
+    return reader;
+}
+
+std::size_t SlicePipeline::getTriangleCount() const {
+    return triangleCount;
+}
+
+std::size_t SlicePipeline::bucketIndex(double minZ, std::size_t numLayers) const {
+    if (minZ <= 0.0) {
+        return 0;
+    }
+    double bucket = std::floor(minZ / layerHeight);
+    return bucket >= numLayers ? numLayers : static_cast<std::size_t>(bucket);
+}
+
+bool SlicePipeline::run(const std::string& filename, const LayerSink& sink) {
+    triangleCount = 0;
+
+    // Pre-pass: count how many triangles start in each layer so the prepare stage knows
+    // when a bucket is complete. Moving the model to a set Z height depends on its lowest
+    // point, so that is found in a pass of its own first. Only one count per layer is kept
+    double modelMinZ = std::numeric_limits<double>::max();
+    double modelMaxZ;
+    double zTranslation = 0.0;
+    if (zHeight.has_value()) {
+        if (!reader.scanFacetMinZ(filename, [&modelMinZ](double minZ) { modelMinZ = std::min(modelMinZ, minZ); }, modelMaxZ)) {
+            return false;
+        }
+        zTranslation = zHeight.value() - modelMinZ;
+    }
+
+    std::vector<std::size_t> expectedCounts;
+    auto countFacet = [&](double minZ) {
+        modelMinZ = std::min(modelMinZ, minZ);
+        std::size_t bucket = bucketIndex(minZ + zTranslation, std::numeric_limits<std::size_t>::max());
+        if (bucket >= expectedCounts.size()) {
+            expectedCounts.resize(bucket + 1, 0);
+        }
+        expectedCounts[bucket]++;
+    };
+    if (!reader.scanFacetMinZ(filename, countFacet, modelMaxZ)) {
+        return false;
+    }
+
+    // Triangles starting above the last layer are never sliced
+    std::size_t numLayers = static_cast<std::size_t>(std::max(0.0, ceil((modelMaxZ - modelMinZ) / layerHeight)));
+    expectedCounts.resize(numLayers, 0);
+
+    BoundedQueue<TriangleBatch> batchQueue(queueCapacity);
+    BoundedQueue<TriangleBucket> bucketQueue(queueCapacity);
+    BoundedQueue<Layer> layerQueue(queueCapacity);
+    BoundedQueue<Layer> finishedQueue(queueCapacity);
+    bool loaded = false;
+
+    // Load: parse the file, translate each triangle into place and send it on in batches
+    std::thread loadThread([&]() {
+        TriangleBatch batch;
+        batch.reserve(TRIANGLE_BATCH_SIZE);
+        loaded = reader.streamSTL(filename, [&](const Triangle& triangle) {
+            Triangle placed = triangle;
+            for (auto& vertex : placed.vertices) {
+                vertex.z += zTranslation;
+            }
+            batch.push_back(placed);
+            if (batch.size() == TRIANGLE_BATCH_SIZE) {
+                batchQueue.push(std::move(batch));
+                batch = TriangleBatch();
+                batch.reserve(TRIANGLE_BATCH_SIZE);
+            }
+        });
+        if (!batch.empty()) {
+            batchQueue.push(std::move(batch));
+        }
+        batchQueue.close();
+    });
+
+    // Prepare: bucket triangles by layer and release complete buckets in order
+    std::thread prepareThread([&]() {
+        std::vector<TriangleBucket> buckets(numLayers);
+        std::vector<std::size_t> arrivedCounts(numLayers, 0);
+        std::size_t nextBucket = 0;
+
+        while (auto batch = batchQueue.pop()) {
+            for (const auto& triangle : *batch) {
+                double minZ = std::min({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+                double maxZ = std::max({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+                std::size_t bucket = bucketIndex(minZ, numLayers);
+                if (bucket < numLayers) {
+                    buckets[bucket].push_back(TriangleZRange{triangle, minZ, maxZ});
+                    arrivedCounts[bucket]++;
+                }
+            }
+            triangleCount += batch->size();
+
+            while (nextBucket < numLayers && arrivedCounts[nextBucket] >= expectedCounts[nextBucket]) {
+                bucketQueue.push(std::move(buckets[nextBucket]));
+                nextBucket++;
+            }
+        }
+
+        // The load stage stops early on a malformed facet, so release whatever is left
+        for (; nextBucket < numLayers; nextBucket++) {
+            bucketQueue.push(std::move(buckets[nextBucket]));
+        }
+        bucketQueue.close();
+    });
+
+    // Slice: sweep up through the buckets, keeping only triangles that reach the current layer
+    std::thread sliceThread([&]() {
+        std::vector<TriangleZRange> active;
+        for (std::size_t i = 0; i < numLayers; i++) {
+            auto bucket = bucketQueue.pop();
+            if (!bucket) {
+                break;
+            }
+            active.insert(active.end(), std::make_move_iterator(bucket->begin()), std::make_move_iterator(bucket->end()));
+
+            double layerZ = i * layerHeight;
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [layerZ](const TriangleZRange& range) { return range.maxZ < layerZ; }),
+                         active.end());
+
+            Layer currentLayer;
+            currentLayer.height = layerZ;
+            for (const auto& range : active) {
+                if (range.minZ <= layerZ) {
+                    Slicer::sliceTriangle(range.triangle, layerZ, layerHeight, currentLayer);
+                }
+            }
+            buildLayerContours(currentLayer);
+            layerQueue.push(std::move(currentLayer));
+        }
+        layerQueue.close();
+    });
+
+    // Perimeter: inset a batch of layers at a time, one layer per thread, and pass them on in order
+    std::thread perimeterThread([&]() {
+        if (!perimeterGenerator) {
+            finishedQueue.close();
+            return;
+        }
+        std::size_t batchSize = resolveThreadCount(threadCount);
+        std::vector<Layer> batch;
+        bool open = true;
+        while (open) {
+            batch.clear();
+            while (batch.size() < batchSize) {
+                auto layer = layerQueue.pop();
+                if (!layer) {
+                    open = false;
+                    break;
+                }
+                batch.push_back(std::move(*layer));
+            }
+            parallelFor(batch.size(), batchSize, [&](std::size_t i) {
+                perimeterGenerator->generateLayer(batch[i]);
+            });
+            for (auto& layer : batch) {
+                finishedQueue.push(std::move(layer));
+            }
+        }
+        finishedQueue.close();
+    });
+
+    // Write: hand finished layers to the sink
+    std::thread writeThread([&]() {
+        BoundedQueue<Layer>& source = perimeterGenerator ? finishedQueue : layerQueue;
+        while (auto layer = source.pop()) {
+            sink(std::move(*layer));
+        }
+    });
+
+    loadThread.join();
+    prepareThread.join();
+    sliceThread.join();
+    perimeterThread.join();
+    writeThread.join();
+
+    return loaded && triangleCount > 0;
+}
@@ -1,69 +1,196 @@
 #include "Slicer.h"
+#include "Contours.h"
+#include "Parallel.h"
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <limits>
+#include <utility>
 
 
-Slicer::TriangleZRange::TriangleZRange(const Triangle* t) : triangle(t) {
-    minZ = std::min({t->vertices[0].z, t->vertices[1].z, t->vertices[2].z});
-    maxZ = std::max({t->vertices[0].z, t->vertices[1].z, t->vertices[2].z});
+namespace {
+    const std::size_t TRIANGLES_PER_CHUNK = 16384; // Smallest amount of index-building work handed to one thread
+
+    // Rounds a Z-bound outwards to a float, so the stored interval always contains the exact one
+    float floatBelow(double z) {
+        float f = static_cast<float>(z);
+        return f > z ? std::nextafter(f, -INFINITY) : f;
+    }
+
+    float floatAbove(double z) {
+        float f = static_cast<float>(z);
+        return f < z ? std::nextafter(f, INFINITY) : f;
+    }
 }
 
-Slicer::Slicer(const STLReader& stlReader, double layerHeight)
-    : stlReader(stlReader), layerHeight(layerHeight) {
+Slicer::Slicer(const STLReader& stlReader, double layerHeight, std::size_t threadCount)
+    : stlReader(stlReader), layerHeight(layerHeight), threadCount(threadCount) {
         prepareTriangles();
     }
 
+long long Slicer::bucketIndex(double z) const {
+    return static_cast<long long>(std::floor((z - bucketBase) / bucketHeight));
+}
+
 void Slicer::prepareTriangles() {
     const auto& triangles = stlReader.getTriangles();
-    triangleRanges.reserve(triangles.size());
+    const std::size_t triangleCount = triangles.size();
+    zIndex.clear();
+    bucketStart.assign(1, 0);
+    bucketReach.clear();
+    if (triangleCount == 0) {
+        return;
+    }
+    if (triangleCount > std::numeric_limits<std::uint32_t>::max()) {
+        std::cerr << "Too many triangles to index for slicing: " << triangleCount << std::endl;
+        return;
+    }
+
+    const std::size_t chunkCount = std::min(resolveThreadCount(threadCount),
+                                            (triangleCount + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK);
+    auto chunkBegin = [&](std::size_t chunk) { return triangleCount * chunk / chunkCount; };
+
+    // Find the range of minimum Z-heights, which the buckets cover
+    std::vector<double> chunkLowest(chunkCount), chunkHighest(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        double lowest = INFINITY, highest = -INFINITY;
+        for (std::size_t t = chunkBegin(chunk); t < chunkBegin(chunk + 1); t++) {
+            const Triangle& triangle = triangles[t];
+            double minZ = std::min({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+            lowest = std::min(lowest, minZ);
+            highest = std::max(highest, minZ);
+        }
+        chunkLowest[chunk] = lowest;
+        chunkHighest[chunk] = highest;
+    });
+    bucketBase = *std::min_element(chunkLowest.begin(), chunkLowest.end());
+    double top = *std::max_element(chunkHighest.begin(), chunkHighest.end());
+
+    // One bucket per layer, unless that would mean more buckets than triangles
+    bucketHeight = std::max(layerHeight, (top - bucketBase) / triangleCount);
+    const std::size_t bucketCount = static_cast<std::size_t>(bucketIndex(top)) + 1;
 
-    for (const auto& triangle : triangles) {
-        triangleRanges.emplace_back(&triangle);
+    // Count the triangles each chunk puts in each bucket
+    std::vector<std::uint32_t> buckets(triangleCount);
+    std::vector<std::size_t> counts(chunkCount * bucketCount, 0);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t* chunkCounts = &counts[chunk * bucketCount];
+        for (std::size_t t = chunkBegin(chunk); t < chunkBegin(chunk + 1); t++) {
+            const Triangle& triangle = triangles[t];
+            double minZ = std::min({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+            std::size_t bucket = std::min<std::size_t>(bucketIndex(minZ), bucketCount - 1);
+            buckets[t] = static_cast<std::uint32_t>(bucket);
+            chunkCounts[bucket]++;
+        }
+    });
+
+    // Turn the counts into write offsets, chunks in order within each bucket so the sort is stable
+    bucketStart.assign(bucketCount + 1, 0);
+    std::size_t offset = 0;
+    for (std::size_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStart[bucket] = offset;
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++) {
+            std::size_t count = counts[chunk * bucketCount + bucket];
+            counts[chunk * bucketCount + bucket] = offset;
+            offset += count;
+        }
     }
+    bucketStart[bucketCount] = offset;
 
-    // Sort triangles based on their minimum Z-coordinate
-    std::sort(triangleRanges.begin(), triangleRanges.end(),
-              [](const TriangleZRange& a, const TriangleZRange& b) {
-                  return a.minZ < b.minZ;
-              });
+    zIndex.resize(triangleCount);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t* offsets = &counts[chunk * bucketCount];
+        for (std::size_t t = chunkBegin(chunk); t < chunkBegin(chunk + 1); t++) {
+            const Triangle& triangle = triangles[t];
+            double minZ = std::min({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+            double maxZ = std::max({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z});
+            zIndex[offsets[buckets[t]]++] = ZIntervalEntry{static_cast<std::uint32_t>(t), floatBelow(minZ), floatAbove(maxZ)};
+        }
+    });
+
+    // The highest point reached from each bucket or below tells sliceLayer where to start
+    bucketReach.assign(bucketCount, -INFINITY);
+    parallelFor(bucketCount, threadCount, [&](std::size_t bucket) {
+        for (std::size_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+            bucketReach[bucket] = std::max<double>(bucketReach[bucket], zIndex[i].maxZ);
+        }
+    });
+    for (std::size_t bucket = 1; bucket < bucketCount; bucket++) {
+        bucketReach[bucket] = std::max(bucketReach[bucket], bucketReach[bucket - 1]);
+    }
 }
 
 void Slicer::sliceModel() {
-    const auto& triangles = stlReader.getTriangles();
     double modelHeight = stlReader.getMaximumBoundingBox().z - stlReader.getMinimumBoundingBox().z;
     int numLayers = ceil(modelHeight / layerHeight);
+    if (numLayers <= 0) {
+        layers.clear();
+        return;
+    }
 
-    std::size_t triangleIndex = 0;
+    layers.assign(numLayers, Layer());
 
-    // Create a new slice layer and check if each triangle is fully in this slice layer, or intersects it
-    for (int i = 0; i < numLayers; i++) {
-        double layerZ = i * layerHeight;
-        Layer currentLayer;
-        currentLayer.height = layerZ;
+    // Split the layers into contiguous chunks, each with its own cursor into the Z-interval index,
+    // and slice, measure and inset the chunks in parallel
+    std::size_t chunkCount = std::min<std::size_t>(numLayers, resolveThreadCount(threadCount) * 4);
+    parallelFor(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t begin = numLayers * chunk / chunkCount;
+        std::size_t end = numLayers * (chunk + 1) / chunkCount;
+        std::size_t triangleIndex = 0;
 
-        // Advance triangleIndex to the first relevant triangle
-        while (triangleIndex < triangleRanges.size() && triangleRanges[triangleIndex].maxZ < layerZ) {
-            triangleIndex++;
-        }
+        // Create a new slice layer and check if each triangle is fully in this slice layer, or intersects it
+        for (std::size_t i = begin; i < end; i++) {
+            Layer& currentLayer = layers[i];
+            currentLayer.height = i * layerHeight;
 
-        // Process relevant triangles
-        for (std::size_t j = triangleIndex; j < triangleRanges.size(); j++) {
-            const auto& triangleRange = triangleRanges[j];
-            if (triangleRange.minZ > layerZ) {
-                break;  // No more relevant triangles for this layer
+            sliceLayer(currentLayer.height, triangleIndex, currentLayer);
+            buildLayerContours(currentLayer);
+            if (perimeterGenerator) {
+                perimeterGenerator->generateLayer(currentLayer);
             }
+        }
+    });
+}
 
-            const Triangle& tri = *triangleRange.triangle;
-            if (isTriangleInLayer(tri, layerZ, layerHeight)) {
-                addProjectedTriangleToLayer(tri, layerZ, currentLayer);
-            } else if (doesTriangleIntersectLayer(tri, layerZ)) {
-                addIntersectionLinesToLayer(tri, layerZ, currentLayer);
-            }
+void Slicer::setPerimeterGenerator(const PerimeterGenerator* perimeterGenerator) {
+    this->perimeterGenerator = perimeterGenerator;
+}
+
+void Slicer::sliceLayer(double layerZ, std::size_t& triangleIndex, Layer& layer) const {
+    long long lastBucket = bucketIndex(layerZ);
+    if (bucketReach.empty() || lastBucket < 0) {
+        return;  // Every triangle starts above this layer
+    }
+    std::size_t last = std::min<std::size_t>(lastBucket, bucketReach.size() - 1);
+
+    // Skip the buckets whose triangles all end below this layer
+    triangleIndex = std::lower_bound(bucketReach.begin() + std::min(triangleIndex, bucketReach.size()),
+                                     bucketReach.end(), layerZ) - bucketReach.begin();
+
+    // Only the buckets up to this layer's one can hold triangles starting at or below it
+    const auto& triangles = stlReader.getTriangles();
+    for (std::size_t j = bucketStart[std::min(triangleIndex, last + 1)]; j < bucketStart[last + 1]; j++) {
+        const ZIntervalEntry& entry = zIndex[j];
+        if (entry.maxZ < layerZ || entry.minZ > layerZ) {
+            continue;
+        }
+
+        // The stored bounds are widened, so check the exact start of the triangle
+        const Triangle& triangle = triangles[entry.triangle];
+        if (std::min({triangle.vertices[0].z, triangle.vertices[1].z, triangle.vertices[2].z}) > layerZ) {
+            continue;
         }
+        sliceTriangle(triangle, layerZ, layerHeight, layer);
+    }
+}
 
-        layers.push_back(currentLayer);
+void Slicer::sliceTriangle(const Triangle& triangle, double layerZ, double thickness, Layer& layer) {
+    if (isTriangleInLayer(triangle, layerZ, thickness)) {
+        addProjectedTriangleToLayer(triangle, layerZ, layer);
+    }
+    if (doesTriangleIntersectLayer(triangle, layerZ)) {
+        addIntersectionLinesToLayer(triangle, layerZ, layer);
     }
 }
 
@@ -82,15 +209,15 @@ void Slicer::addProjectedTriangleToLayer(const Triangle& triangle, double layerZ
     Point2D v2 = {triangle.vertices[1].x, triangle.vertices[1].y};
     Point2D v3 = {triangle.vertices[2].x, triangle.vertices[2].y};
 
-    layer.lines.push_back({v1, v2});
-    layer.lines.push_back({v2, v3});
-    layer.lines.push_back({v3, v1});
+    layer.projectedLines.push_back({v1, v2});
+    layer.projectedLines.push_back({v2, v3});
+    layer.projectedLines.push_back({v3, v1});
 }
 
 bool Slicer::doesTriangleIntersectLayer(const Triangle& triangle, double layerZ) {
-    return (triangle.vertices[0].z < layerZ && triangle.vertices[1].z >= layerZ) ||
-           (triangle.vertices[1].z < layerZ && triangle.vertices[2].z >= layerZ) ||
-           (triangle.vertices[2].z < layerZ && triangle.vertices[0].z >= layerZ);
+    return (triangle.vertices[0].z <= layerZ && triangle.vertices[1].z > layerZ) ||
+           (triangle.vertices[1].z <= layerZ && triangle.vertices[2].z > layerZ) ||
+           (triangle.vertices[2].z <= layerZ && triangle.vertices[0].z > layerZ);
 }
 
 void Slicer::addIntersectionLinesToLayer(const Triangle& triangle, double layerZ, Layer& layer) {
@@ -100,15 +227,20 @@ void Slicer::addIntersectionLinesToLayer(const Triangle& triangle, double layerZ
     // Iterate through each triangle edge and see if it is intersected by the layer.
     // If yes, determine how far along the line the intersection is, and add it to our layer.
     for (int i = 0; i < 3; ++i) {
-        const Point3D& p1 = triangle.vertices[i];
-        const Point3D& p2 = triangle.vertices[(i + 1) % 3];
+        const Point3D* p1 = &triangle.vertices[i];
+        const Point3D* p2 = &triangle.vertices[(i + 1) % 3];
 
-        // Check if crosses slice plane - one point below, and the other on/above plane
-        if ((p1.z < layerZ && p2.z >= layerZ) || (p2.z < layerZ && p1.z >= layerZ)) {
-            double dist_along = (layerZ - p1.z) / (p2.z - p1.z);
+        // Check if crosses slice plane - one point on/below plane, and the other above
+        if ((p1->z <= layerZ && p2->z > layerZ) || (p2->z <= layerZ && p1->z > layerZ)) {
+            // Always interpolate from the lower end, so the triangles either side of a shared
+            // edge produce bit-identical points and the lines can be stitched exactly
+            if (p1->z > p2->z) {
+                std::swap(p1, p2);
+            }
+            double dist_along = (layerZ - p1->z) / (p2->z - p1->z);
             Point2D intersection = {
-                p1.x + (dist_along * (p2.x - p1.x)),
-                p1.y + (dist_along * (p2.y - p1.y))
+                p1->x + (dist_along * (p2->x - p1->x)),
+                p1->y + (dist_along * (p2->y - p1->y))
             };
             intersectionPoints.push_back(intersection);
         }
@@ -118,6 +250,17 @@ void Slicer::addIntersectionLinesToLayer(const Triangle& triangle, double layerZ
 
     // If there are two intersection points, add them to our layer list
     if (intersectionPoints.size() == 2) {
+        // A vertex touching the plane from above gives a zero-length line, which adds nothing
+        if (intersectionPoints[0].x == intersectionPoints[1].x && intersectionPoints[0].y == intersectionPoints[1].y) {
+            return;
+        }
+
+        // Orient the line so the outward normal is on its right, which makes outer
+        // boundaries counter-clockwise and holes clockwise
+        Point2D direction = intersectionPoints[1] - intersectionPoints[0];
+        if (direction.y * triangle.normal.x - direction.x * triangle.normal.y < 0) {
+            std::swap(intersectionPoints[0], intersectionPoints[1]);
+        }
         layer.lines.push_back({intersectionPoints[0], intersectionPoints[1]});
     }
     else if (intersectionPoints.size() != 2) {
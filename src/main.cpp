@@ -1,16 +1,76 @@
 #include <iostream>
 #include <string>
 #include <optional>
+#include <cmath>
+#include <algorithm>
 #include "STLReader.h"
 #include "Slicer.h"
+#include "Plate.h"
+#include "SlicePipeline.h"
+#include "OutOfCoreSlicer.h"
+#include "LayerExport.h"
+#include "OverhangAnalyzer.h"
+#include "OrientationOptimizer.h"
+#include "MeshDecimator.h"
+#include "PerimeterGenerator.h"
+#include "Contours.h"
+#include <memory>
+#include <vector>
 
 
+/**
+ * @brief Running totals of the per-layer statistics, so they can be gathered from streamed layers.
+ */
+struct LayerSummary {
+    std::size_t layerCount = 0;
+    double material = 0.0;
+    double largestArea = 0.0;
+    double largestAreaHeight = 0.0;
+    std::size_t perimeterLoops = 0;
+    double perimeterLength = 0.0;
+
+    void add(const Layer& layer, double layerHeight) {
+        layerCount++;
+        material += layer.stats.area * layerHeight;
+        if (layer.stats.area > largestArea) {
+            largestArea = layer.stats.area;
+            largestAreaHeight = layer.height;
+        }
+        for (const auto& perimeter : layer.perimeters) {
+            perimeterLoops += perimeter.size();
+            for (const auto& loop : perimeter) {
+                perimeterLength += calculateContourLength(loop);
+            }
+        }
+    }
+
+    void print() const {
+        std::cout << "The largest cross-section is " << largestArea << " mm^2 at Z = " << largestAreaHeight << "." << std::endl;
+        std::cout << "The material estimated from layer areas is " << material << " mm^3." << std::endl;
+        if (perimeterLoops > 0) {
+            std::cout << "Generated " << perimeterLoops << " perimeter loops, " << perimeterLength << " mm in total." << std::endl;
+        }
+    }
+};
+
 void printUsage(const char* programName) {
     std::cerr << "Usage: " << programName << " <stl_file_path> [options]" << std::endl;
     std::cerr << "Options:" << std::endl;
     std::cerr << "  -s <value>    Scales the model, applied before -z" << std::endl;
     std::cerr << "  -t <value>     Set layer height for slicing (in mm)" << std::endl;
     std::cerr << "  -z <value>    Set Z-height of the model" << std::endl;
+    std::cerr << "  -c <value>    Number of copies to arrange on the build plate when slicing" << std::endl;
+    std::cerr << "  -p            Load, slice and write concurrently (requires -t, ignores -s, -c, -r, -d and -a)" << std::endl;
+    std::cerr << "  -o <value>    Slice out-of-core in on-disk bands of this many layers (requires -t, ignores -s, -c, -r, -d and -a)" << std::endl;
+    std::cerr << "  -j <value>    Number of threads for parallel work (default: all hardware threads)" << std::endl;
+    std::cerr << "  -l <dir>      Write each sliced layer as an SVG file into this directory" << std::endl;
+    std::cerr << "  -b <file>     Write the sliced contours to this compact binary contour file" << std::endl;
+    std::cerr << "  -a <value>    Report overhangs steeper than this angle from vertical (in degrees), building along +Z (not with -p or -o)" << std::endl;
+    std::cerr << "  -r            Rotate the model to the best build orientation, applied after -s and before -z" << std::endl;
+    std::cerr << "  -d <value>    Decimate the model to about this many triangles before anything else (not with -p or -o)" << std::endl;
+    std::cerr << "  -n <value>    Number of perimeters to generate inside each layer's contours" << std::endl;
+    std::cerr << "  -w <value>    Perimeter line width (in mm, default: 0.4)" << std::endl;
+    std::cerr << "  -u            Round the perimeter corners instead of mitering them" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -25,6 +85,18 @@ int main(int argc, char* argv[]) {
     std::optional<float> scaleFactor;
     std::optional<float> layerHeight;
     std::optional<float> zHeight;
+    std::optional<int> copies;
+    bool pipelined = false;
+    std::optional<int> layersPerBand;
+    std::size_t threadCount = 0;
+    std::optional<std::string> svgDirectory;
+    std::optional<std::string> contourFile;
+    std::optional<float> overhangAngle;
+    bool autoOrient = false;
+    std::optional<long> decimateTarget;
+    std::optional<int> perimeterCount;
+    std::optional<float> lineWidth;
+    bool roundJoins = false;
 
     // Parse command-line arguments
     for (int i = 2; i < argc; i++) {
@@ -38,13 +110,159 @@ int main(int argc, char* argv[]) {
         if (arg == "-z" && i + 1 < argc) {
             zHeight = std::stof(argv[++i]);
         }
+        if (arg == "-c" && i + 1 < argc) {
+            copies = std::stoi(argv[++i]);
+        }
+        if (arg == "-p") {
+            pipelined = true;
+        }
+        if (arg == "-o" && i + 1 < argc) {
+            layersPerBand = std::stoi(argv[++i]);
+        }
+        if (arg == "-j" && i + 1 < argc) {
+            threadCount = std::stoul(argv[++i]);
+        }
+        if (arg == "-l" && i + 1 < argc) {
+            svgDirectory = argv[++i];
+        }
+        if (arg == "-b" && i + 1 < argc) {
+            contourFile = argv[++i];
+        }
+        if (arg == "-a" && i + 1 < argc) {
+            overhangAngle = std::stof(argv[++i]);
+        }
+        if (arg == "-r") {
+            autoOrient = true;
+        }
+        if (arg == "-d" && i + 1 < argc) {
+            decimateTarget = std::stol(argv[++i]);
+        }
+        if (arg == "-n" && i + 1 < argc) {
+            perimeterCount = std::stoi(argv[++i]);
+        }
+        if (arg == "-w" && i + 1 < argc) {
+            lineWidth = std::stof(argv[++i]);
+        }
+        if (arg == "-u") {
+            roundJoins = true;
+        }
         
     }
 
+    // Every sliced layer goes through here, whichever mode produced it
+    LayerSummary summary;
+    std::vector<std::unique_ptr<LayerExporter>> exporters;
+    if (svgDirectory.has_value()) {
+        exporters.push_back(std::make_unique<SVGExporter>(svgDirectory.value()));
+    }
+    if (contourFile.has_value()) {
+        exporters.push_back(std::make_unique<ContourExporter>(contourFile.value()));
+    }
+    std::unique_ptr<PerimeterGenerator> perimeterGenerator;
+    if (perimeterCount.has_value() && perimeterCount.value() > 0) {
+        PerimeterSettings settings;
+        settings.count = perimeterCount.value();
+        settings.lineWidth = lineWidth.value_or(0.4f);
+        settings.joinType = roundJoins ? JoinType::Round : JoinType::Miter;
+        perimeterGenerator = std::make_unique<PerimeterGenerator>(settings);
+        perimeterGenerator->setThreadCount(threadCount);
+    }
+
+    auto handleLayer = [&](const Layer& layer) {
+        summary.add(layer, layerHeight.value());
+        for (auto& exporter : exporters) {
+            exporter->addLayer(layer);
+        }
+    };
+    auto finishLayers = [&]() {
+        bool exported = true;
+        for (auto& exporter : exporters) {
+            exported = exporter->finish() && exported;
+        }
+        summary.print();
+        if (!exported) {
+            std::cerr << "Failed to write some layer output." << std::endl;
+        }
+        return exported;
+    };
+
+    // The streaming modes never hold the whole model, so options that work on it cannot apply
+    auto warnUnsupportedOptions = [&](const char* mode) {
+        std::vector<std::string> ignored;
+        if (scaleFactor.has_value()) {
+            ignored.push_back("-s (scaling)");
+        }
+        if (copies.has_value()) {
+            ignored.push_back("-c (copies)");
+        }
+        if (autoOrient) {
+            ignored.push_back("-r (orientation)");
+        }
+        if (decimateTarget.has_value()) {
+            ignored.push_back("-d (decimation)");
+        }
+        if (overhangAngle.has_value()) {
+            ignored.push_back("-a (overhang analysis)");
+        }
+        for (const auto& option : ignored) {
+            std::cerr << "Option " << option << " is not supported in " << mode << " mode, ignoring it." << std::endl;
+        }
+    };
+
+    if (layersPerBand.has_value() && layerHeight.has_value()) {
+        warnUnsupportedOptions("out-of-core");
+
+        OutOfCoreSlicer outOfCoreSlicer(layerHeight.value(), std::max(1, layersPerBand.value()));
+        outOfCoreSlicer.setThreadCount(threadCount);
+        outOfCoreSlicer.setPerimeterGenerator(perimeterGenerator.get());
+        if (zHeight.has_value()) {
+            outOfCoreSlicer.setZHeight(zHeight.value());
+        }
+
+        if (!outOfCoreSlicer.run(filename, [&](Layer&& layer) { handleLayer(layer); })) {
+            std::cerr << "Failed to slice STL file out-of-core." << std::endl;
+            return 1;
+        }
+
+        std::cout << "Successfully read " << outOfCoreSlicer.getTriangleCount() << " triangles." << std::endl;
+        std::cout << "Largest band held " << outOfCoreSlicer.getLargestBandSize() << " triangles in memory." << std::endl;
+        std::cout << "Model sliced into " << summary.layerCount << " layers." << std::endl;
+        return finishLayers() ? 0 : 1;
+    }
+
+    if (pipelined && layerHeight.has_value()) {
+        warnUnsupportedOptions("pipelined");
+
+        SlicePipeline pipeline(layerHeight.value());
+        pipeline.setThreadCount(threadCount);
+        pipeline.setPerimeterGenerator(perimeterGenerator.get());
+        if (zHeight.has_value()) {
+            pipeline.setZHeight(zHeight.value());
+        }
+
+        if (!pipeline.run(filename, [&](Layer&& layer) { handleLayer(layer); })) {
+            std::cerr << "Failed to read STL file." << std::endl;
+            return 1;
+        }
+
+        std::cout << "Successfully read " << pipeline.getTriangleCount() << " triangles." << std::endl;
+        std::cout << "The total surface area of the part is " << pipeline.getReader().getTotalSurfaceArea() << " mm^2." << std::endl;
+        std::cout << "Model sliced into " << summary.layerCount << " layers." << std::endl;
+        return finishLayers() ? 0 : 1;
+    }
+
     if (reader.readSTL(filename)) {
         std::cout << "Successfully read " << reader.getTriangles().size() << " triangles." << std::endl;
     } else {
         std::cerr << "Failed to read STL file." << std::endl;
+        return 1;
+    }
+
+    if (decimateTarget.has_value()) {
+        MeshDecimator decimator(reader);
+        decimator.setThreadCount(threadCount);
+        reader.setTriangles(decimator.decimateToCount(static_cast<std::size_t>(std::max(1L, decimateTarget.value()))));
+        std::cout << "Model decimated to " << reader.getTriangles().size() << " triangles." << std::endl;
     }
 
     if (scaleFactor.has_value()) {
@@ -52,6 +270,15 @@ int main(int argc, char* argv[]) {
         std::cout << "Model scaled by a factor of " << scaleFactor.value() << std::endl;
     }
 
+    if (autoOrient) {
+        OrientationOptimizer optimizer(reader);
+        optimizer.setThreadCount(threadCount);
+        OrientationResult orientation = optimizer.findBestOrientation(layerHeight.value_or(0.1f), overhangAngle.value_or(45.0f));
+        OrientationOptimizer::applyOrientation(reader, orientation);
+        std::cout << "Oriented the model to build along " << orientation.buildDirection << ", rotating by "
+                  << orientation.rotationAngle << " degrees about " << orientation.rotationAxis << "." << std::endl;
+    }
+
     if (zHeight.has_value()) {
         reader.setZHeight(zHeight.value());
         std::cout << "Set Z height to " << zHeight.value() << std::endl;
@@ -61,12 +288,60 @@ int main(int argc, char* argv[]) {
     std::cout << "The total volume of the part is " << reader.getVolume() << " mm^3." << std::endl;
     std::cout << "The model bounding box is: Minimum: " << reader.getMinimumBoundingBox() << " and Maximum: " << reader.getMaximumBoundingBox() << std::endl;
 
-    if (layerHeight.has_value()) {
-        Slicer slicer(reader, layerHeight.value());
+    if (overhangAngle.has_value()) {
+        OverhangAnalyzer analyzer(reader);
+        analyzer.setThreadCount(threadCount);
+        OverhangReport report = analyzer.analyze(Vector3D{0, 0, 1}, overhangAngle.value());
+
+        std::cout << report.overhangTriangleCount << " facets overhang by more than " << overhangAngle.value() << " degrees, covering "
+                  << report.overhangArea << " mm^2 (" << report.projectedArea << " mm^2 projected)." << std::endl;
+        std::cout << "The overhangs form " << report.regions.size() << " regions, needing an estimated "
+                  << report.supportVolume << " mm^3 of support." << std::endl;
+        std::cout << "The base contact area is " << report.baseContactArea << " mm^2." << std::endl;
+    }
+
+    if (layerHeight.has_value() && copies.has_value() && copies.value() > 1) {
+        // Arrange the copies in a square-ish grid with a fixed gap between bounding boxes
+        const double gap = 5.0;
+        Point3D minBound = reader.getMinimumBoundingBox();
+        Point3D maxBound = reader.getMaximumBoundingBox();
+        double pitchX = (maxBound.x - minBound.x) + gap;
+        double pitchY = (maxBound.y - minBound.y) + gap;
+        int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(copies.value()))));
+
+        Plate plate(layerHeight.value());
+        plate.setThreadCount(threadCount);
+        plate.setPerimeterGenerator(perimeterGenerator.get());
+        std::size_t meshIndex = plate.addMesh(reader);
+        for (int i = 0; i < copies.value(); i++) {
+            Vector3D offset{(i % columns) * pitchX, (i / columns) * pitchY, 0.0};
+            plate.addInstance(meshIndex, Placement{offset, 0.0});
+        }
+        plate.sliceModel();
+
+        const auto& layers = plate.getLayers();
+        std::cout << "Plate of " << plate.getInstanceCount() << " copies sliced into " << layers.size() << " layers." << std::endl;
+
+        for (const auto& layer : layers) {
+            handleLayer(layer);
+        }
+        if (!finishLayers()) {
+            return 1;
+        }
+    } else if (layerHeight.has_value()) {
+        Slicer slicer(reader, layerHeight.value(), threadCount);
+        slicer.setPerimeterGenerator(perimeterGenerator.get());
         slicer.sliceModel();
         
         const auto& layers = slicer.getLayers();
         std::cout << "Model sliced into " << layers.size() << " layers." << std::endl;
+
+        for (const auto& layer : layers) {
+            handleLayer(layer);
+        }
+        if (!finishLayers()) {
+            return 1;
+        }
     }
 
     return 0;
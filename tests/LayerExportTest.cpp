@@ -0,0 +1,151 @@
+#include "LayerExport.h"
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* description) {
+        if (!condition) {
+            std::cerr << "FAILED: " << description << std::endl;
+            failures++;
+        }
+    }
+
+    std::vector<Layer> sampleLayers() {
+        Layer bottom;
+        bottom.height = 0.2;
+        bottom.contours.push_back(Contour{{{0.0, 0.0}, {10.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}}, true});
+        bottom.contours.push_back(Contour{{{4.0, 4.0}, {4.0, 6.0}, {6.0, 6.0}, {6.0, 4.0}}, true});
+        Layer top;
+        top.height = 0.4;
+        top.contours.push_back(Contour{{{-1.2345, 2.5}, {3.0005, -7.25}}, false});
+        return {bottom, top};
+    }
+
+    bool writeLayers(const std::string& path, bool compress) {
+        ContourExporter exporter(path, 0.001, compress);
+        for (const auto& layer : sampleLayers()) {
+            exporter.addLayer(layer);
+        }
+        return exporter.finish();
+    }
+
+    std::vector<Layer> readLayers(const std::string& path, bool& ok) {
+        std::vector<Layer> layers;
+        ok = readContourFile(path, [&layers](Layer&& layer) { layers.push_back(std::move(layer)); });
+        return layers;
+    }
+
+    bool sameContours(const std::vector<Layer>& read, const std::vector<Layer>& written) {
+        if (read.size() != written.size()) {
+            return false;
+        }
+        for (std::size_t l = 0; l < read.size(); l++) {
+            if (read[l].height != written[l].height || read[l].contours.size() != written[l].contours.size()) {
+                return false;
+            }
+            for (std::size_t c = 0; c < read[l].contours.size(); c++) {
+                const Contour& a = read[l].contours[c];
+                const Contour& b = written[l].contours[c];
+                if (a.closed != b.closed || a.points.size() != b.points.size()) {
+                    return false;
+                }
+                for (std::size_t p = 0; p < a.points.size(); p++) {
+                    if (std::abs(a.points[p].x - b.points[p].x) > 5e-4 + 1e-9 || std::abs(a.points[p].y - b.points[p].y) > 5e-4 + 1e-9) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    std::vector<char> readBytes(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    void writeBytes(const std::string& path, const std::vector<char>& bytes) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void setU32(std::vector<char>& bytes, std::size_t offset, std::uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            bytes[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+}
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "feta_layer_export_test.bin").string();
+    const std::size_t headerSize = 20;
+    bool ok = false;
+
+    // Both encodings read back to the contours written, to within the resolution
+    for (bool compress : {false, true}) {
+        check(writeLayers(path, compress), "contour file written");
+        std::vector<Layer> layers = readLayers(path, ok);
+        check(ok && sameContours(layers, sampleLayers()), compress ? "deflated contour file round-trips" : "stored contour file round-trips");
+        check(ok && layers.size() == 2 && std::abs(layers[0].stats.area - 96.0) < 1e-6, "layer statistics recalculated on read");
+    }
+
+    // A stored block claiming more encoded bytes than it holds must be rejected, not read past
+    check(writeLayers(path, false), "contour file written");
+    std::vector<char> original = readBytes(path);
+    std::vector<char> corrupt = original;
+    setU32(corrupt, headerSize, 1u << 30);
+    writeBytes(path, corrupt);
+    readLayers(path, ok);
+    check(!ok, "stored block with mismatched sizes rejected");
+
+    // A stored size running past the end of the file
+    corrupt = original;
+    setU32(corrupt, headerSize + 4, 1u << 30);
+    writeBytes(path, corrupt);
+    readLayers(path, ok);
+    check(!ok, "block running past the end of the file rejected");
+
+    // A truncated block
+    corrupt.assign(original.begin(), original.end() - 3);
+    writeBytes(path, corrupt);
+    readLayers(path, ok);
+    check(!ok, "truncated contour file rejected");
+
+    if (ContourExporter::compressionAvailable()) {
+        // A deflated block claiming to expand far beyond what deflate can produce
+        check(writeLayers(path, true), "contour file written");
+        corrupt = readBytes(path);
+        setU32(corrupt, headerSize, 0xFFFFFFFFu);
+        writeBytes(path, corrupt);
+        readLayers(path, ok);
+        check(!ok, "deflated block with an impossible size rejected");
+    }
+
+    // A path that cannot be opened fails the writer, without stopping the blocks for other paths
+    {
+        const std::string missing = (std::filesystem::temp_directory_path() / "feta_missing_directory" / "layer.bin").string();
+        AsyncFileWriter writer;
+        writer.write(missing, std::vector<char>{'a'});
+        writer.write(missing, std::vector<char>{'b'});
+        writer.write(path, std::vector<char>{'c', 'd'});
+        writer.write(missing, std::vector<char>{'e'});
+        check(!writer.close(), "writer reports a path it could not open");
+        check(readBytes(path) == std::vector<char>{'c', 'd'}, "writer carries on with other paths");
+    }
+
+    std::filesystem::remove(path);
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "All layer export tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "PerimeterGenerator.h"
+#include "Contours.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* description) {
+        if (!condition) {
+            std::cerr << "FAILED: " << description << std::endl;
+            failures++;
+        }
+    }
+
+    Contour square(double minX, double minY, double size) {
+        return Contour{{{minX, minY}, {minX + size, minY}, {minX + size, minY + size}, {minX, minY + size}}, true};
+    }
+
+    double totalArea(const std::vector<Contour>& contours) {
+        double area = 0.0;
+        for (const auto& contour : contours) {
+            area += calculateSignedArea(contour);
+        }
+        return area;
+    }
+
+    Contour polygon(const std::vector<Point2D>& points) {
+        return Contour{points, true};
+    }
+
+    Contour star(std::size_t tips, double outerRadius, double innerRadius) {
+        std::vector<Point2D> points;
+        for (std::size_t i = 0; i < 2 * tips; i++) {
+            double angle = M_PI * static_cast<double>(i) / static_cast<double>(tips);
+            double radius = i % 2 == 0 ? outerRadius : innerRadius;
+            points.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+        }
+        return polygon(points);
+    }
+
+    // Smallest distance from any point of the loops to the walls they were offset from
+    double wallClearance(const std::vector<Contour>& loops, const std::vector<Contour>& walls) {
+        double clearance = INFINITY;
+        for (const auto& loop : loops) {
+            for (const auto& point : loop.points) {
+                for (const auto& wall : walls) {
+                    for (std::size_t i = 0; i < wall.points.size(); i++) {
+                        const Point2D& start = wall.points[i];
+                        const Point2D& end = wall.points[(i + 1) % wall.points.size()];
+                        double dx = end.x - start.x, dy = end.y - start.y;
+                        double t = std::clamp(((point.x - start.x) * dx + (point.y - start.y) * dy) / (dx * dx + dy * dy), 0.0, 1.0);
+                        clearance = std::min(clearance, std::hypot(point.x - start.x - t * dx, point.y - start.y - t * dy));
+                    }
+                }
+            }
+        }
+        return clearance;
+    }
+}
+
+int main() {
+    for (JoinType joinType : {JoinType::Miter, JoinType::Round}) {
+        PerimeterSettings settings;
+        settings.joinType = joinType;
+        PerimeterGenerator generator(settings);
+
+        // A 4 mm square shrinks to a 2 mm one, then vanishes once the inset passes its half-width
+        std::vector<Contour> pin{square(0.0, 0.0, 4.0)};
+        std::vector<Contour> inset = generator.offsetContours(pin, 1.0);
+        check(inset.size() == 1 && std::abs(totalArea(inset) - 4.0) < 1e-6, "square insets to a smaller square");
+        check(generator.offsetContours(pin, 3.0).empty(), "square collapsed under a 3 mm inset");
+        check(generator.offsetContours(pin, 5.0).empty(), "square collapsed under a 5 mm inset");
+
+        // The thin square must vanish without leaving anything beside the wide one
+        std::vector<Contour> plate{square(0.0, 0.0, 30.0), square(40.0, 0.0, 2.0)};
+        std::vector<Contour> plateInset = generator.offsetContours(plate, 1.5);
+        check(plateInset.size() == 1 && std::abs(totalArea(plateInset) - 27.0 * 27.0) < 1e-6, "thin square beside a wide one collapsed");
+
+        // Non-convex shapes: the inset must keep its distance from inward corners as well as edges.
+        // Round joins follow the true offset, miters stay inside it
+        bool round = joinType == JoinType::Round;
+        double arcSlack = settings.arcTolerance + 1e-3;
+
+        // The tips collapse and the inward corners round off towards the centre
+        std::vector<Contour> starShape{star(10, 6.0, 2.0)};
+        std::vector<Contour> starInset = generator.offsetContours(starShape, 1.0);
+        check(wallClearance(starInset, starShape) > 1.0 - arcSlack, "star inset keeps its distance from the walls");
+        check(round ? starInset.size() == 1 && std::abs(totalArea(starInset) - 3.37) < 0.05 : totalArea(starInset) < 3.37, "star inset area");
+
+        std::vector<Contour> lShape{polygon({{0.0, 0.0}, {10.0, 0.0}, {10.0, 3.0}, {3.0, 3.0}, {3.0, 10.0}, {0.0, 10.0}})};
+        std::vector<Contour> lInset = generator.offsetContours(lShape, 1.0);
+        check(lInset.size() == 1 && wallClearance(lInset, lShape) > 1.0 - arcSlack, "L-shape inset keeps its distance from the walls");
+        check(std::abs(totalArea(lInset) - (round ? 16.0 - M_PI / 4.0 : 15.0)) < 0.05, "L-shape inset area");
+
+        // The hole grows by the inset, with rounded corners for round joins
+        std::vector<Contour> frame{square(0.0, 0.0, 10.0), polygon({{4.0, 4.0}, {4.0, 6.0}, {6.0, 6.0}, {6.0, 4.0}})};
+        std::vector<Contour> frameInset = generator.offsetContours(frame, 1.0);
+        check(frameInset.size() == 2 && wallClearance(frameInset, frame) > 1.0 - arcSlack, "square with a hole insets to two loops");
+        check(std::abs(totalArea(frameInset) - (round ? 64.0 - 12.0 - M_PI : 48.0)) < 0.05, "square with a hole inset area");
+
+        // The narrow bridge vanishes and leaves the two ends apart
+        std::vector<Contour> dumbbell{polygon({{0.0, 0.0}, {4.0, 0.0}, {4.0, 1.85}, {6.0, 1.85}, {6.0, 0.0}, {10.0, 0.0},
+                                               {10.0, 4.0}, {6.0, 4.0}, {6.0, 2.15}, {4.0, 2.15}, {4.0, 4.0}, {0.0, 4.0}})};
+        std::vector<Contour> dumbbellInset = generator.offsetContours(dumbbell, 1.0);
+        check(dumbbellInset.size() == 2 && wallClearance(dumbbellInset, dumbbell) > 1.0 - arcSlack, "dumbbell inset splits in two");
+        check(round ? std::abs(totalArea(dumbbellInset) - 8.0) < 0.01 : totalArea(dumbbellInset) < 8.0 + 1e-6, "dumbbell inset area");
+    }
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "All perimeter tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "STLReader.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef FETA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* description) {
+        if (!condition) {
+            std::cerr << "FAILED: " << description << std::endl;
+            failures++;
+        }
+    }
+
+    const char* TETRAHEDRON =
+        "solid tetrahedron\n"
+        "  facet normal 0 0 -1\n    outer loop\n      vertex 0 0 0\n      vertex 0 1 0\n      vertex 1 0 0\n    endloop\n  endfacet\n"
+        "  facet normal 0 -1 0\n    outer loop\n      vertex 0 0 0\n      vertex 1 0 0\n      vertex 0 0 1\n    endloop\n  endfacet\n"
+        "  facet normal -1 0 0\n    outer loop\n      vertex 0 0 0\n      vertex 0 0 1\n      vertex 0 1 0\n    endloop\n  endfacet\n"
+        "  facet normal 0.57735027 0.57735027 0.57735027\n    outer loop\n      vertex 1 0 0\n      vertex 0 1 0\n      vertex 0 0 1\n    endloop\n  endfacet\n"
+        "endsolid tetrahedron\n";
+
+    bool readsWith(const std::string& path, std::size_t triangleCount) {
+        STLReader reader;
+        return reader.readSTL(path) && reader.getTriangles().size() == triangleCount;
+    }
+}
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string plainPath = (directory / "feta_stl_reader_test.stl").string();
+    {
+        std::ofstream file(plainPath);
+        file << TETRAHEDRON;
+    }
+    check(readsWith(plainPath, 4), "plain ASCII STL read");
+
+#ifdef FETA_HAVE_ZLIB
+    const std::string gzipPath = (directory / "feta_stl_reader_test.stl.gz").string();
+    gzFile gzip = gzopen(gzipPath.c_str(), "wb");
+    gzputs(gzip, TETRAHEDRON);
+    gzclose(gzip);
+    check(readsWith(gzipPath, 4), "gzip STL read");
+
+    // Dropping the length from the gzip trailer leaves every facet readable, but the file is
+    // still damaged and must not be accepted
+    std::vector<char> bytes;
+    {
+        std::ifstream file(gzipPath, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream file(gzipPath, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 4));
+    }
+    check(!readsWith(gzipPath, 4), "gzip STL missing its trailer rejected");
+    std::filesystem::remove(gzipPath);
+#endif
+
+    std::filesystem::remove(plainPath);
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "All STL reader tests passed" << std::endl;
+    return 0;
+}